@@ -13,10 +13,26 @@ UNIT_MEMORY_OPERAND = 9
 UNIT_PC = 10
 UNIT_ABS_IMMEDIATE = 11
 UNIT_ABS_OPERAND = 12
+UNIT_REGISTER_POINTER = 13
+UNIT_CONTROL = 14
+UNIT_BUNDLE = 15
+
+HEADER_PAIR = 0
+HEADER_GUARD = 1
+
+# Units a bundled move can use; see rtl/common.vh.
+PAIR_SRC_UNITS = (UNIT_NONE, UNIT_REGISTER, UNIT_ALU_LEFT, UNIT_ALU_RIGHT,
+                  UNIT_ABS_IMMEDIATE)
+PAIR_DST_UNITS = (UNIT_NONE, UNIT_REGISTER, UNIT_ALU_LEFT, UNIT_ALU_RIGHT,
+                  UNIT_ALU_OPERATOR)
 
 class Instr():
 
-    def __init__(self, sunit, si, dunit, di, soperand=None, doperand=None):
+    # pair is a move to bundle with this one, made in the same cycle.
+    # guard is (UNIT_REGISTER or UNIT_ALU_RESULT, N) to squash the move when
+    # that's zero, or when it isn't with guard_invert.
+    def __init__(self, sunit, si, dunit, di, soperand=None, doperand=None,
+                 pair=None, guard=None, guard_invert=False):
         op = 0
         op |= sunit
         op |= si << 4
@@ -29,9 +45,33 @@ class Instr():
         self.soperand = soperand
         self.doperand = doperand
         self.op = op
+        self.pair = pair
+        if pair is not None:
+            assert pair.pair is None
+            assert pair.sunit in PAIR_SRC_UNITS and pair.si < 0x100
+            assert pair.dunit in PAIR_DST_UNITS and pair.di < 0x100
+        self.guard = guard
+        self.guard_invert = guard_invert
+        if guard is not None:
+            assert guard[0] in (UNIT_REGISTER, UNIT_ALU_RESULT)
+            assert guard[1] < 0x100
+
+    def header(self):
+        p = self.pair
+        return (UNIT_BUNDLE | p.sunit << 4 | p.si << 8 | p.dunit << 16 |
+                p.di << 20 | HEADER_PAIR << 28)
+
+    def guard_header(self):
+        unit, n = self.guard
+        return (UNIT_BUNDLE | unit << 4 | n << 8 | int(self.guard_invert) << 16 |
+                HEADER_GUARD << 28)
 
     def hex(self):
         asm = "{:08x}".format(self.op)
+        if self.pair is not None:
+            asm = "{:08x} ".format(self.header()) + asm
+        if self.guard is not None:
+            asm = "{:08x} ".format(self.guard_header()) + asm
         if self.sunit == UNIT_MEMORY_OPERAND or self.sunit == UNIT_ABS_OPERAND:
             asm = asm + " {:08x}".format(self.soperand)
         if self.dunit == UNIT_MEMORY_OPERAND or self.dunit == UNIT_ABS_OPERAND:
@@ -39,6 +79,16 @@ class Instr():
         return asm
 
     def asm(self):
+        asm = self.move_asm()
+        if self.pair is not None:
+            asm += " || " + self.pair.move_asm()
+        if self.guard is not None:
+            unit, n = self.guard
+            name = "R{:02x}".format(n) if unit == UNIT_REGISTER else "ALU{}:RESULT".format(n)
+            asm = "({}{}) ".format("!" if self.guard_invert else "", name) + asm
+        return asm
+
+    def move_asm(self):
         asm = ""
         if self.dunit == UNIT_NONE:
             return "NOP"
@@ -1,38 +1,102 @@
 `include "common.vh"
 
+// Works continuously on its current operands and operator: changing any of
+// them starts the operation again. Most operators finish by the following
+// clock. MUL takes MUL_CYCLES and DIV and MOD DIV_CYCLES, iterating a few
+// bits at a time so that neither sits on the critical path; busy_o is high
+// until data_o holds the result for the current inputs.
 module alu_unit(
     input wire rst_i,
     input wire clk_i,
-    input wire sel_i,
     input ALU_OPERATOR oper_i,
 
     input logic [31:0] a_data_i,
     input logic [31:0] b_data_i,
-    output logic [31:0] data_o
+    output logic [31:0] data_o,
+    output wire busy_o
 );
+    localparam MUL_BITS = 4;  // Multiplier bits per cycle
+    localparam MUL_CYCLES = 32 / MUL_BITS;
+    localparam DIV_CYCLES = 32;  // One quotient bit per cycle
+
+    // The inputs the operation in progress (or finished) was started with.
+    ALU_OPERATOR oper;
+    logic [31:0] a;
+    logic [31:0] b;
+    logic [5:0] cycles_left;
+
+    wire restart = oper_i != oper || a_data_i != a || b_data_i != b;
+    assign busy_o = restart || cycles_left != 0;
+
+    // Iterative multiply: MUL_BITS of the multiplier per cycle, low first.
+    logic [31:0] product;
+    logic [31:0] multiplicand;
+    logic [31:0] multiplier;
+
+    // Restoring division, one quotient bit per cycle. The dividend shifts
+    // out of quotient as the quotient shifts in.
+    logic [32:0] remainder;
+    logic [31:0] quotient;
 
     always @(posedge clk_i) begin
         if (rst_i) begin
             data_o <= 32'b0;
-        end else if (sel_i) begin
-            case (oper_i)
+            oper = ALU_NOP;
+            a = 32'b0;
+            b = 32'b0;
+            cycles_left = 0;
+        end else if (restart) begin
+            oper = oper_i;
+            a = a_data_i;
+            b = b_data_i;
+            cycles_left = 0;
+            case (oper)
                 ALU_NOP: data_o <= 31'b0;
-                ALU_ADD: data_o <= a_data_i+b_data_i;
-                ALU_SUB: data_o <= a_data_i-b_data_i;
-                ALU_DIV: data_o <= a_data_i/b_data_i;
-                ALU_MUL: data_o <= a_data_i*b_data_i;
-                ALU_MOD: data_o <= a_data_i%b_data_i;
-                ALU_EQL: data_o <= a_data_i == b_data_i;
-                ALU_SL: data_o <= a_data_i << b_data_i;
-                ALU_SR: data_o <= a_data_i >> b_data_i;
-                ALU_SRA: data_o <= a_data_i >>> b_data_i;
-                ALU_NOT: data_o <= ~a_data_i; // what about not b?
-                ALU_AND: data_o <= a_data_i && b_data_i;
-                ALU_OR: data_o <= a_data_i || b_data_i;
-                ALU_XOR: data_o <= ^ a_data_i; // what about ^ b;?
-                ALU_GT: data_o <= a_data_i > b_data_i;
-                ALU_LT: data_o <= a_data_i < b_data_i;
+                ALU_ADD: data_o <= a+b;
+                ALU_SUB: data_o <= a-b;
+                ALU_DIV, ALU_MOD: begin
+                    remainder = 33'b0;
+                    quotient = a;
+                    cycles_left = DIV_CYCLES;
+                end
+                ALU_MUL: begin
+                    product = 32'b0;
+                    multiplicand = a;
+                    multiplier = b;
+                    cycles_left = MUL_CYCLES;
+                end
+                ALU_EQL: data_o <= a == b;
+                ALU_SL: data_o <= a << b;
+                ALU_SR: data_o <= a >> b;
+                ALU_SRA: data_o <= a >>> b;
+                ALU_NOT: data_o <= ~a; // what about not b?
+                ALU_AND: data_o <= a && b;
+                ALU_OR: data_o <= a || b;
+                ALU_XOR: data_o <= ^ a; // what about ^ b;?
+                ALU_GT: data_o <= a > b;
+                ALU_LT: data_o <= a < b;
+            endcase
+        end else if (cycles_left != 0) begin
+            if (oper == ALU_MUL) begin
+                product = product + multiplicand * multiplier[MUL_BITS-1:0];
+                multiplicand = multiplicand << MUL_BITS;
+                multiplier = multiplier >> MUL_BITS;
+            end else begin
+                {remainder, quotient} = {remainder[31:0], quotient, 1'b0};
+                if (remainder >= {1'b0, b}) begin
+                    remainder = remainder - {1'b0, b};
+                    quotient[0] = 1'b1;
+                end
+            end
+            cycles_left = cycles_left - 1;
+            if (cycles_left == 0) case (oper)
+                ALU_MUL: data_o <= product;
+                // Division by zero gives zero, as it did when this was the
+                // combinational operator.
+                ALU_DIV: data_o <= b == 0 ? 32'b0 : quotient;
+                ALU_MOD: data_o <= b == 0 ? 32'b0 : remainder[31:0];
+                default: ;
             endcase
         end
     end
-endmodule : alu_unit
\ No newline at end of file
+endmodule : alu_unit
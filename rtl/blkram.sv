@@ -2,7 +2,8 @@ module blkram
     #(
         parameter RAM_WIDTH = 32,                    // Specify RAM data width
         parameter RAM_DEPTH = 1024,                  // Specify RAM depth (number of entries)
-        parameter INIT_FILE = ""                     // Specify name/location of RAM initialization file if using one (leave blank if not)
+        parameter INIT_FILE = "",                    // Specify name/location of RAM initialization file if using one (leave blank if not)
+        parameter PIPELINED = 0                      // Accept a request every cycle, for masters which follow data_bus.accept
     )
     (
         input wire clk_i,
@@ -10,7 +11,8 @@ module blkram
 
         bus_if.slave data_bus
     );
-    (* ram_style = "block" *) reg [RAM_WIDTH-1:0] bram_reg [RAM_DEPTH-1:0];
+    // Public so that test benches can load it directly.
+    (* ram_style = "block" *) reg [RAM_WIDTH-1:0] bram_reg [RAM_DEPTH-1:0] /*verilator public_flat_rw*/;
     reg [31:0] reg_data;
 
     wire [31:0] bus_addr;
@@ -34,37 +36,62 @@ module blkram
 
     logic state;
     reg ready_reg;
-    always @(posedge clk_i) begin
-        if (rst_i) begin
-            ready_reg <= 1'b0;
-            state <= 1'b0;
-            reg_data <= 32'b0;
-        end else
-            case (state)
-                0: begin
-                    if (data_bus.valid) begin
-                        ready_reg <= 1'b1;
-                        if (data_bus.wstrb != 4'b0) begin
-                            if (data_bus.wstrb[3])
-                                bram_reg[data_bus.addr][31:24] <= data_bus.write_data[31:24];
-                            if (data_bus.wstrb[2])
-                                bram_reg[data_bus.addr][23:16] <= data_bus.write_data[23:16];
-                            if (data_bus.wstrb[1])
-                                bram_reg[data_bus.addr][15:8] <= data_bus.write_data[15:8];
-                            if (data_bus.wstrb[0])
-                                bram_reg[data_bus.addr][7:0] <= data_bus.write_data[7:0];
-                        end
-                        reg_data <= bram_reg[data_bus.addr];
-                        state <= 1;
-                    end
+
+    task access;
+        if (data_bus.wstrb != 4'b0) begin
+            if (data_bus.wstrb[3])
+                bram_reg[data_bus.addr][31:24] <= data_bus.write_data[31:24];
+            if (data_bus.wstrb[2])
+                bram_reg[data_bus.addr][23:16] <= data_bus.write_data[23:16];
+            if (data_bus.wstrb[1])
+                bram_reg[data_bus.addr][15:8] <= data_bus.write_data[15:8];
+            if (data_bus.wstrb[0])
+                bram_reg[data_bus.addr][7:0] <= data_bus.write_data[7:0];
+        end
+        reg_data <= bram_reg[data_bus.addr];
+    endtask
+
+    generate
+        if (PIPELINED) begin : pipelined
+            // Registered read: take whatever is on the bus each cycle, and
+            // answer it on the next.
+            assign data_bus.accept = data_bus.valid;
+            always @(posedge clk_i) begin
+                if (rst_i) begin
+                    ready_reg <= 1'b0;
+                    reg_data <= 32'b0;
+                end else begin
+                    ready_reg <= data_bus.valid;
+                    if (data_bus.valid) access();
                 end
-                1: begin
+            end
+        end else begin : single
+            // One request at a time. The cycle with ready high is spent idle,
+            // since a master holding its request until it's answered only
+            // moves on once it sees ready.
+            assign data_bus.accept = ready_reg;
+            always @(posedge clk_i) begin
+                if (rst_i) begin
                     ready_reg <= 1'b0;
                     state <= 1'b0;
-                end
-            endcase
-
-    end
+                    reg_data <= 32'b0;
+                end else
+                    case (state)
+                        0: begin
+                            if (data_bus.valid) begin
+                                ready_reg <= 1'b1;
+                                access();
+                                state <= 1;
+                            end
+                        end
+                        1: begin
+                            ready_reg <= 1'b0;
+                            state <= 1'b0;
+                        end
+                    endcase
+            end
+        end
+    endgenerate
 
     assign data_bus.read_data = reg_data;
     assign data_bus.ready = ready_reg;
@@ -1,3 +1,12 @@
+// A master presents a request with valid, and the slave answers it with
+// ready and read_data.
+//
+// accept says the request on the bus is taken at this clock edge. Masters
+// which follow it may then present the next one straight away, and so keep
+// several outstanding; responses come back on ready in the order the
+// requests were taken. Slaves which only handle one request at a time drive
+// accept with ready, which leaves masters that ignore accept, and hold each
+// request until it's answered, working as before.
 interface bus_if;
     logic [3:0] wstrb;
     logic [31:0] write_data;
@@ -5,16 +14,17 @@ interface bus_if;
     logic valid;
     logic instr;
 
+    logic accept;
     logic ready;
     logic [31:0] read_data;
 
     modport master (
-      input read_data, ready,
+      input read_data, ready, accept,
       output wstrb, write_data, addr, valid, instr
     );
 
     modport slave (
         input wstrb, write_data, addr, valid, instr,
-        output  read_data, ready
+        output  read_data, ready, accept
     );
 endinterface : bus_if
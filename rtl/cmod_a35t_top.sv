@@ -1,4 +1,9 @@
-module cmod_a35t_top (
+`include "common.vh"
+
+module cmod_a35t_top #(
+    // 115200 baud off the 12MHz clock.
+    parameter UART_CLKS_PER_BIT = 104
+) (
     input wire rst_i,
     input wire sysclk_i,
 
@@ -25,20 +30,44 @@ module cmod_a35t_top (
     );
 
     bus_if data_bus();
+    bus_if sram_bus();
+    bus_if uart_bus();
+    io_split io_split(
+        .cpu_bus(data_bus.slave),
+        .mem_bus(sram_bus.master),
+        .io_bus(uart_bus.master)
+    );
+
     always_comb begin
-        data_bus.read_data = sram_data_i;
-        data_bus.ready = sram_ready_i;
-        sram_data_o = data_bus.write_data;
-        sram_valid_o = data_bus.valid;
-        sram_wstrb_o = data_bus.wstrb;
-        sram_addr_o = data_bus.addr;
+        sram_bus.read_data = sram_data_i;
+        sram_bus.ready = sram_ready_i;
+        sram_bus.accept = sram_ready_i;
+        sram_data_o = sram_bus.write_data;
+        sram_valid_o = sram_bus.valid;
+        sram_wstrb_o = sram_bus.wstrb;
+        sram_addr_o = sram_bus.addr;
     end
 
+    wire uart_rx_ready;
+    wire uart_tx_empty;
+    uart #(
+        .CLKS_PER_BIT(UART_CLKS_PER_BIT)
+    ) uart(
+        .clk_i(sysclk_i),
+        .rst_i(rst_i),
+        .bus(uart_bus.slave),
+        .rxd_i(uart_rxd_i),
+        .txd_o(uart_txd_o),
+        .rx_ready_o(uart_rx_ready),
+        .tx_empty_o(uart_tx_empty)
+    );
+
     tta tta(
         .rst_i(rst_i),
         .clk_i(sysclk_i),
         .instr_bus(bootmem_bus),
-        .data_bus(data_bus)
+        .data_bus(data_bus),
+        .irq_i({6'b0, uart_tx_empty, uart_rx_ready})
     );
 
 endmodule : cmod_a35t_top
\ No newline at end of file
@@ -22,8 +22,8 @@ typedef enum bit [3:0] {
 
 typedef enum bit[3:0] {
     UNIT_NONE = 0,
-    UNIT_STACK_PUSH_POP = 1,  // TODO: Not implemented yet
-    UNIT_STACK_INDEX = 2,     // TODO: Not implemented yet
+    UNIT_STACK_PUSH_POP = 1,  // Push as a destination, pop as a source
+    UNIT_STACK_INDEX = 2,     // Entry N below the top of the stack
     UNIT_REGISTER = 3,
     UNIT_ALU_LEFT = 4,
     UNIT_ALU_RIGHT = 5,
@@ -34,7 +34,107 @@ typedef enum bit[3:0] {
     UNIT_PC = 10,
     UNIT_ABS_IMMEDIATE = 11,
     UNIT_ABS_OPERAND = 12,
-    UNIT_REGISTER_POINTER = 13  // Value of memory address in register N
+    UNIT_REGISTER_POINTER = 13,  // Value of memory address in register N
+    UNIT_CONTROL = 14,           // Control register N, see ControlReg
+    UNIT_BUNDLE = 15             // Instruction header, see HeaderKind
 } Unit;
 
+// A word with UNIT_BUNDLE in bits [3:0] isn't a move, but a header applying
+// to the instruction following it, of the kind in bits [31:28]. An
+// instruction can have one of each kind, in any order.
+typedef enum bit[3:0] {
+    // Carries a move to be made together with the instruction, in a narrower
+    // form: [7:4] src unit, [15:8] si, [19:16] dst unit, [27:20] di. It's
+    // limited to the units execute can read and write alongside anything else
+    // in a single cycle: UNIT_NONE, UNIT_REGISTER, UNIT_ALU_LEFT, UNIT_ALU_RIGHT
+    // or UNIT_ABS_IMMEDIATE as the source, and UNIT_NONE, UNIT_REGISTER,
+    // UNIT_ALU_LEFT, UNIT_ALU_RIGHT or UNIT_ALU_OPERATOR as the destination.
+    // Both moves read their sources before either writes; should they write
+    // the same place, the bundled move wins.
+    HEADER_PAIR = 4'h0,
+    // Squashes the instruction, and any bundled move, if the value guarding
+    // it is zero: [7:4] UNIT_REGISTER for register N, or UNIT_ALU_RESULT for
+    // ALU N's result, waiting for it if busy; [15:8] N. Bit [16] inverts the
+    // guard, squashing if the value is non-zero. A squashed instruction
+    // retires without reading its source or writing its destination.
+    HEADER_GUARD = 4'h1
+} HeaderKind;
+
+// Access width for UNIT_MEMORY_OPERAND and UNIT_REGISTER_POINTER, in bits
+// [11:8] of their immediate. Everything but MEM_WORD takes a byte address,
+// little endian; halfwords are aligned, so address bit 0 is ignored.
+typedef enum bit[3:0] {
+    MEM_WORD = 4'h0,         // Word address
+    MEM_BYTE = 4'h1,         // Zero extended
+    MEM_BYTE_SIGNED = 4'h2,  // Sign extended
+    MEM_HALF = 4'h3,
+    MEM_HALF_SIGNED = 4'h4
+} MemWidth;
+
+// Pointer update for UNIT_REGISTER_POINTER, in bits [7:6] of its immediate;
+// the register is in bits [4:0]. The step is the access size in address
+// units: 1 for words and bytes, 2 for halfwords.
+typedef enum bit[1:0] {
+    PTR_PLAIN = 2'h0,
+    PTR_POST_INC = 2'h1,  // Access, then add the step
+    PTR_PRE_DEC = 2'h2    // Subtract the step, then access
+} PtrMode;
+
+// Registers reachable through UNIT_CONTROL.
+// Performance counters count from reset, wrap at 32 bits, and can be written
+// to set (e.g. clear) them.
+typedef enum bit[11:0] {
+    CTRL_PERF_CYCLES = 12'h000,          // Clock cycles
+    CTRL_PERF_INSTRET = 12'h001,         // Retired instructions
+    CTRL_PERF_OPERAND_FETCHES = 12'h002, // Operand words read by the sequencer
+    CTRL_PERF_DATA_STALLS = 12'h003,     // Cycles waiting on data_bus.ready
+    CTRL_PERF_ALU_READS = 12'h004,       // Reads of UNIT_ALU_RESULT
+    CTRL_ALU_BUSY = 12'h010,             // Read only. Bit N: ALU N is still working
+    // Hardware loop. While the count is non-zero, the sequencer reaching the
+    // end address (the word after the loop's last instruction) decrements it
+    // and, unless it's reached zero, carries on from the start address.
+    // Writing the count starts the loop; it runs the instructions from start
+    // to end that many times. The last one mustn't write the PC.
+    CTRL_LOOP_START = 12'h020,
+    CTRL_LOOP_END = 12'h021,
+    CTRL_LOOP_COUNT = 12'h022,
+    // Interrupts. Between instructions, a line both raised and enabled makes
+    // the sequencer save the address of the next instruction in the EPC and
+    // carry on from the vector instead, in the same cycle, so the handler's
+    // first fetch starts as soon as the interrupted instruction has finished.
+    // Further interrupts wait until the handler writes CTRL_IRQ_RETURN, which
+    // goes back to the EPC. Handlers save whatever they use themselves.
+    // Writes anywhere in 0x030-0x03f hold up the sequencer like PC writes.
+    CTRL_IRQ_ENABLE = 12'h030,   // Bit N enables line N, see IrqSource
+    CTRL_IRQ_PENDING = 12'h031,  // Read only. Bit N: line N is raised
+    CTRL_IRQ_VECTOR = 12'h032,   // Handler address
+    CTRL_IRQ_EPC = 12'h033,      // Where the handler returns to
+    CTRL_IRQ_RETURN = 12'h034    // Write anything to return from the handler
+} ControlReg;
+
+// Interrupt lines, as bits of CTRL_IRQ_ENABLE and CTRL_IRQ_PENDING. They're
+// levels, held until the cause is dealt with.
+typedef enum bit[2:0] {
+    IRQ_UART_RX = 3'h0,       // A received byte is waiting in UART_DATA
+    IRQ_UART_TX_EMPTY = 3'h1  // The UART has nothing left to send
+} IrqSource;
+
+// Data bus word addresses from IO_BASE up go to devices rather than memory.
+// Byte and halfword accesses reach them at four times the address.
+`define IO_BASE 32'h3fffff00
+typedef enum bit[31:0] {
+    // Read: the last byte received, clearing status bit 0. Write: send the
+    // byte, unless the UART is still sending; poll status bit 1 first.
+    UART_DATA = `IO_BASE,
+    // Read only. Bit 0: a byte has been received. Bit 1: nothing to send.
+    UART_STATUS = `IO_BASE + 1
+} UartReg;
+
+// simtop's console, see console.sv.
+typedef enum bit[31:0] {
+    // Write: queue the byte for the simulator, waiting while the console's
+    // buffer is full. Read: the number of bytes queued.
+    CONSOLE_DATA = `IO_BASE + 2
+} ConsoleReg;
+
 `endif  // common_vh_
@@ -0,0 +1,45 @@
+`include "common.vh"
+
+// A console for simulation: bytes written to CONSOLE_DATA (see ConsoleReg in
+// common.vh) wait in a DEPTH byte buffer for the simulator to take them a
+// batch at a time, rather than going out bit by bit as the UART sends them.
+// A write to a full buffer isn't taken: ready stays low, and execute.sv
+// keeps the store on the bus until it is. Each write taken adds one byte. A
+// read gives the number of bytes in the buffer.
+//
+// The whole buffer is on data_o, oldest byte at the bottom, with count_o of
+// them in use. drain_i empties it at the next clock; a byte written on that
+// clock is kept, as the first of the next batch.
+module console #(
+    parameter DEPTH = 64
+) (
+    input wire clk_i,
+    input wire rst_i,
+
+    bus_if.slave bus,
+
+    output logic [8*DEPTH-1:0] data_o,
+    output logic [$clog2(DEPTH+1)-1:0] count_o,
+    input wire drain_i
+);
+    wire write = bus.valid && bus.wstrb[0];
+    wire full = count_o == DEPTH;
+
+    assign bus.ready = bus.valid && !(write && full);
+    assign bus.accept = bus.ready;
+    assign bus.read_data = 32'(count_o);
+
+    always @(posedge clk_i) begin
+        if (rst_i) begin
+            data_o = '0;
+            count_o = '0;
+        end else begin
+            if (drain_i) count_o = '0;
+            if (write && !full) begin
+                data_o[8*count_o +: 8] = bus.write_data[7:0];
+                count_o = count_o + 1;
+            end
+        end
+    end
+
+endmodule : console
@@ -1,3 +1,6 @@
+// Splits instruction words into their fields. Headers (see HeaderKind in
+// common.vh) are held in the paired_* and guard_* outputs, and bundle_o and
+// guard_o raised along with the instruction decoded next.
 module decoder(
     input wire clk_i,
     input wire rst_i,
@@ -9,9 +12,23 @@ module decoder(
 
     output Unit dst_unit_o,
     output logic [11:0] di_o,
-    output logic need_dst_operand_o
+    output logic need_dst_operand_o,
+
+    output logic bundle_o,
+    output Unit paired_src_unit_o,
+    output logic [11:0] paired_si_o,
+    output Unit paired_dst_unit_o,
+    output logic [11:0] paired_di_o,
+
+    output logic guard_o,
+    output Unit guard_unit_o,
+    output logic [11:0] guard_immediate_o,
+    output logic guard_invert_o
 );
     logic [31:0] src_value;
+    // Headers decoded for the instruction still to come.
+    logic pair_seen;
+    logic guard_seen;
     always @(posedge clk_i) begin
         if (rst_i) begin
             src_unit_o = UNIT_NONE;
@@ -20,17 +37,52 @@ module decoder(
             di_o = 12'b0;
             need_src_operand_o = 1'b0;
             need_dst_operand_o = 1'b0;
+            bundle_o = 1'b0;
+            pair_seen = 1'b0;
+            paired_src_unit_o = UNIT_NONE;
+            paired_dst_unit_o = UNIT_NONE;
+            paired_si_o = 12'b0;
+            paired_di_o = 12'b0;
+            guard_o = 1'b0;
+            guard_seen = 1'b0;
+            guard_unit_o = UNIT_NONE;
+            guard_immediate_o = 12'b0;
+            guard_invert_o = 1'b0;
         end else if (sel_i) begin
-            src_unit_o = Unit'(op_i[3:0]);
-            si_o = op_i[15:4];
-            dst_unit_o = Unit'(op_i[19:16]);
-            di_o = op_i[31:20];
+            if (Unit'(op_i[3:0]) == UNIT_BUNDLE) begin
+                case (HeaderKind'(op_i[31:28]))
+                    HEADER_PAIR: begin
+                        paired_src_unit_o = Unit'(op_i[7:4]);
+                        paired_si_o = {4'b0, op_i[15:8]};
+                        paired_dst_unit_o = Unit'(op_i[19:16]);
+                        paired_di_o = {4'b0, op_i[27:20]};
+                        pair_seen = 1'b1;
+                    end
+                    HEADER_GUARD: begin
+                        guard_unit_o = Unit'(op_i[7:4]);
+                        guard_immediate_o = {4'b0, op_i[15:8]};
+                        guard_invert_o = op_i[16];
+                        guard_seen = 1'b1;
+                    end
+                    default: ;
+                endcase
+            end else begin
+                src_unit_o = Unit'(op_i[3:0]);
+                si_o = op_i[15:4];
+                dst_unit_o = Unit'(op_i[19:16]);
+                di_o = op_i[31:20];
+
+                need_src_operand_o = src_unit_o == UNIT_MEMORY_OPERAND ||
+                    src_unit_o == UNIT_ABS_OPERAND;
+                need_dst_operand_o = dst_unit_o == UNIT_MEMORY_OPERAND ||
+                    dst_unit_o == UNIT_ABS_OPERAND;
 
-            need_src_operand_o = src_unit_o == UNIT_MEMORY_OPERAND ||
-                src_unit_o == UNIT_ABS_OPERAND;
-            need_dst_operand_o = dst_unit_o == UNIT_MEMORY_OPERAND ||
-                dst_unit_o == UNIT_ABS_OPERAND;
+                bundle_o = pair_seen;
+                pair_seen = 1'b0;
+                guard_o = guard_seen;
+                guard_seen = 1'b0;
+            end
         end
     end
             
-endmodule : decoder
\ No newline at end of file
+endmodule : decoder
@@ -1,204 +1,584 @@
 `define NUM_REGISTERS 32
 `define NUM_ALUS 8
+`define STACK_DEPTH 256
 
-module execute(
+module execute #(
+    // Latch each instruction when it's taken, so that the sequencer can fetch
+    // the next one meanwhile. See tta.sv.
+    parameter PIPELINED = 0,
+    // Let a UNIT_ALU_RESULT read wait for a busy ALU off to the side, and
+    // carry on with the instructions after it that don't depend on it.
+    parameter SCOREBOARD = 0
+) (
     input wire clk_i,
     input wire rst_i,
     input wire sel_i,
     input wire [31:0] pc_i,
+    // Where the instruction starts, see sequencer.sv.
+    input wire [31:0] start_pc_i,
     input Unit src_unit_i,
     input logic [11:0] src_immediate_i,
     input logic [31:0] src_operand_i,
     input Unit dst_unit_i,
     input logic [11:0] dst_immediate_i,
     input logic [31:0] dst_operand_i,
+    // A move bundled with the instruction, see common.vh.
+    input wire bundle_i,
+    input Unit paired_src_unit_i,
+    input logic [11:0] paired_src_immediate_i,
+    input Unit paired_dst_unit_i,
+    input logic [11:0] paired_dst_immediate_i,
+    // A guard on the instruction, see common.vh.
+    input wire guard_i,
+    input Unit guard_unit_i,
+    input logic [11:0] guard_immediate_i,
+    input wire guard_invert_i,
     bus_if.master data_bus,
-    output logic done_o
+    output logic done_o,
+
+    // PIPELINED: an instruction is waiting while issue_i differs from
+    // issued_o, which follows it as instructions are taken.
+    input wire issue_i,
+    output logic issued_o,
+
+    // UNIT_PC writes, a one cycle strobe.
+    output logic pc_write_o,
+    output logic [31:0] pc_value_o,
+
+    // One cycle strobe per instruction retired, with its units.
+    output logic retire_o,
+    output Unit retire_src_unit_o,
+    output Unit retire_dst_unit_o,
+    // The PC following the last retired instruction. A taken jump, a
+    // hardware loop going round or an interrupt leaves it where the next
+    // instruction is fetched from, and a parked read leaves it as it was
+    // when the read was parked.
+    output logic [31:0] retire_pc_o,
+    // Where the instruction retiring starts, parked reads included.
+    output logic [31:0] retire_start_pc_o,
+
+    // Control registers (UNIT_CONTROL). Reads are combinational; writes are
+    // a one cycle strobe.
+    output wire [11:0] ctrl_read_addr_o,
+    input wire [31:0] ctrl_read_data_i,
+    output logic ctrl_write_o,
+    output logic [11:0] ctrl_write_addr_o,
+    output logic [31:0] ctrl_write_data_o,
+
+    // High on cycles spent waiting for data_bus.ready.
+    output wire data_stall_o,
+
+    // Bit N is high while ALU N is still working on its inputs.
+    output wire [`NUM_ALUS-1:0] alu_busy_o,
+
+    // SCOREBOARD: high while an ALU read is waiting, and so while
+    // instructions after it may have retired ahead of it.
+    output wire pending_o,
+
+    // Contents of all registers, register N in bits [N*32+31:N*32].
+    output wire [32*`NUM_REGISTERS-1:0] regs_o
 );
+    assign ctrl_read_addr_o = src_immediate_i;
+
     // Registers.
     logic reg_unit_select[`NUM_REGISTERS-1:0];
     logic reg_unit_write[`NUM_REGISTERS-1:0];
     logic [31:0] reg_in_data[`NUM_REGISTERS-1:0];
-    logic [31:0] reg_out_data[`NUM_REGISTERS-1:0];
+    logic [31:0] reg_value[`NUM_REGISTERS-1:0];
     register_unit register_units[`NUM_REGISTERS-1:0] (
         .rst_i(rst_i),
         .clk_i(clk_i),
         .sel_i(reg_unit_select),
         .wstrb_i(reg_unit_write),
         .data_i(reg_in_data),
-        .data_o(reg_out_data)
+        .value_o(reg_value)
     );
+    genvar reg_num;
+    generate
+        for (reg_num = 0; reg_num < `NUM_REGISTERS; reg_num = reg_num + 1) begin : pack_regs
+            assign regs_o[reg_num*32 +: 32] = reg_value[reg_num];
+        end
+    endgenerate
 
-    // ALUs.
-    logic alu_select[`NUM_ALUS-1:0];
+    // ALUs. Each works on its inputs as soon as they're written; results are
+    // read once it's no longer busy.
     logic [31:0] alu_in_data_a[`NUM_ALUS-1:0];
     logic [31:0] alu_in_data_b[`NUM_ALUS-1:0];
     logic [31:0] alu_out_data[`NUM_ALUS-1:0];
     ALU_OPERATOR alu_operation[`NUM_ALUS-1:0];
+    logic alu_busy[`NUM_ALUS-1:0];
     alu_unit alu_unit [`NUM_ALUS-1:0] (
         .rst_i(rst_i),
         .clk_i(clk_i),
-        .sel_i(alu_select),
         .oper_i(alu_operation),
         .a_data_i(alu_in_data_a),
         .b_data_i(alu_in_data_b),
-        .data_o(alu_out_data)
+        .data_o(alu_out_data),
+        .busy_o(alu_busy)
     );
+    genvar alu_num;
+    generate
+        for (alu_num = 0; alu_num < `NUM_ALUS; alu_num = alu_num + 1) begin : pack_alu_busy
+            assign alu_busy_o[alu_num] = alu_busy[alu_num];
+        end
+    endgenerate
+
+    // The stack, for UNIT_STACK_PUSH_POP and UNIT_STACK_INDEX. Read
+    // asynchronously so that pops and peeks are as quick as register reads;
+    // that makes it distributed rather than block RAM. stack_ptr is the
+    // number of entries pushed, and wraps, as do indexes below the top.
+    (* ram_style = "distributed" *) logic [31:0] stack[`STACK_DEPTH-1:0];
+    logic [$clog2(`STACK_DEPTH)-1:0] stack_ptr;
+
+    function automatic logic [$clog2(`STACK_DEPTH)-1:0] stack_index(logic [11:0] below_top);
+        return stack_ptr - 1 - below_top[$clog2(`STACK_DEPTH)-1:0];
+    endfunction
 
     // Execution state machine.
     typedef enum {
         EXEC_START_SRC,
         EXEC_SRC_MEM_RETRIEVE,
         EXEC_SRC_ALU_RETRIEVE,
-        EXEC_START_DST
+        EXEC_START_DST,
+        EXEC_DST_MEM_STORE
     } ExecState;
     ExecState exec_state;
     logic [31:0] src_value;
+    // Address of the memory source, in bytes unless src_width is MEM_WORD.
+    MemWidth src_width;
+    logic [31:0] src_addr;
+
+    // The instruction being executed, latched from the inputs when it starts.
+    Unit src_unit;
+    logic [11:0] src_immediate;
+    logic [31:0] src_operand;
+    Unit dst_unit;
+    logic [11:0] dst_immediate;
+    logic [31:0] dst_operand;
+    logic [31:0] pc;
+    logic [31:0] start_pc;
+    logic bundle;
+    Unit paired_src_unit;
+    logic [11:0] paired_src_immediate;
+    Unit paired_dst_unit;
+    logic [11:0] paired_dst_immediate;
+    logic [31:0] paired_value;
+
+    // Non-pipelined, the sequencer holds sel_i for as long as the instruction
+    // runs. Pipelined, keep going until back at EXEC_START_SRC, and start
+    // again when there's another instruction waiting.
+    wire run = PIPELINED ? exec_state != EXEC_START_SRC || issue_i != issued_o : sel_i;
+
+    assign data_stall_o = run && exec_state inside {EXEC_SRC_MEM_RETRIEVE, EXEC_DST_MEM_STORE} &&
+                          ~data_bus.ready;
+
+    // Bundled moves. The source is read as the instruction starts, and the
+    // destination written as it finishes, whatever it does in between.
+    function automatic logic [31:0] paired_source;
+        case (paired_src_unit)
+            UNIT_REGISTER: return reg_value[paired_src_immediate[4:0]];
+            UNIT_ALU_LEFT: return alu_in_data_a[paired_src_immediate[$clog2(`NUM_ALUS)-1:0]];
+            UNIT_ALU_RIGHT: return alu_in_data_b[paired_src_immediate[$clog2(`NUM_ALUS)-1:0]];
+            UNIT_ABS_IMMEDIATE: return {20'b0, paired_src_immediate};
+            default: return 32'b0;
+        endcase
+    endfunction
+
+    task write_paired;
+        logic [4:0] r;
+        logic [$clog2(`NUM_ALUS)-1:0] alu;
+        r = paired_dst_immediate[4:0];
+        alu = paired_dst_immediate[$clog2(`NUM_ALUS)-1:0];
+        case (paired_dst_unit)
+            UNIT_REGISTER: begin
+                reg_unit_select[r] = 1'b1;
+                reg_unit_write[r] = 1'b1;
+                reg_in_data[r] = paired_value;
+            end
+            UNIT_ALU_LEFT: alu_in_data_a[alu] = paired_value;
+            UNIT_ALU_RIGHT: alu_in_data_b[alu] = paired_value;
+            UNIT_ALU_OPERATOR: alu_operation[alu] = ALU_OPERATOR'(paired_value);
+            default: ;
+        endcase
+    endtask
+
+    // After the instruction's own destination, so the bundled move's write
+    // wins if they're the same.
+    task finish;
+        if (bundle) write_paired();
+        done_o = 1'b1;
+        exec_state = EXEC_START_SRC;
+        retire_o <= 1'b1;
+        retire_src_unit_o <= src_unit;
+        retire_dst_unit_o <= dst_unit;
+        retire_pc_o <= pc;
+        retire_start_pc_o <= start_pc;
+    endtask
+
+    // Retire without doing anything, bar releasing the sequencer from a
+    // branch, or a write to the interrupt registers, with the PC it already
+    // has.
+    task squash_instruction;
+        if (dst_unit == UNIT_PC ||
+            (dst_unit == UNIT_CONTROL && {dst_immediate[11:4], 4'b0} == CTRL_IRQ_ENABLE)) begin
+            pc_write_o <= 1'b1;
+            pc_value_o <= pc;
+        end
+        bundle = 1'b0;
+        finish();
+    endtask
+
+    // Whether a destination goes over the data bus, and so needs a cycle of
+    // its own after the source is read.
+    function automatic logic is_memory(Unit u);
+        return u == UNIT_MEMORY_OPERAND || u == UNIT_MEMORY_IMMEDIATE || u == UNIT_REGISTER_POINTER;
+    endfunction
+
+    // Sub-word accesses. The immediate is free for a width when the address
+    // comes from elsewhere.
+    function automatic MemWidth mem_width(Unit u, logic [11:0] immediate);
+        if (u == UNIT_MEMORY_OPERAND || u == UNIT_REGISTER_POINTER) return MemWidth'(immediate[11:8]);
+        return MEM_WORD;
+    endfunction
+
+    function automatic logic [31:0] word_addr(MemWidth w, logic [31:0] addr);
+        return w == MEM_WORD ? addr : addr >> 2;
+    endfunction
+
+    function automatic logic [31:0] load_data(MemWidth w, logic [31:0] addr, logic [31:0] word);
+        logic [7:0] b;
+        logic [15:0] h;
+        b = word[addr[1:0]*8 +: 8];
+        h = word[addr[1]*16 +: 16];
+        case (w)
+            MEM_BYTE: return {24'b0, b};
+            MEM_BYTE_SIGNED: return {{24{b[7]}}, b};
+            MEM_HALF: return {16'b0, h};
+            MEM_HALF_SIGNED: return {{16{h[15]}}, h};
+            default: return word;
+        endcase
+    endfunction
+
+    function automatic logic [3:0] store_strobe(MemWidth w, logic [31:0] addr);
+        case (w)
+            MEM_BYTE, MEM_BYTE_SIGNED: return 4'b0001 << addr[1:0];
+            MEM_HALF, MEM_HALF_SIGNED: return addr[1] ? 4'b1100 : 4'b0011;
+            default: return 4'b1111;
+        endcase
+    endfunction
+
+    function automatic logic [31:0] store_data(MemWidth w, logic [31:0] value);
+        case (w)
+            MEM_BYTE, MEM_BYTE_SIGNED: return {4{value[7:0]}};
+            MEM_HALF, MEM_HALF_SIGNED: return {2{value[15:0]}};
+            default: return value;
+        endcase
+    endfunction
+
+    // Address a register pointer access goes to, writing back the register
+    // if its mode updates it.
+    task pointer_access(input logic [11:0] immediate, output logic [31:0] addr);
+        logic [4:0] r;
+        logic [31:0] step;
+        r = immediate[4:0];
+        step = MemWidth'(immediate[11:8]) inside {MEM_HALF, MEM_HALF_SIGNED} ? 2 : 1;
+        addr = reg_value[r];
+        case (PtrMode'(immediate[7:6]))
+            PTR_POST_INC: begin
+                reg_unit_select[r] = 1'b1;
+                reg_unit_write[r] = 1'b1;
+                reg_in_data[r] = addr + step;
+            end
+            PTR_PRE_DEC: begin
+                addr = addr - step;
+                reg_unit_select[r] = 1'b1;
+                reg_unit_write[r] = 1'b1;
+                reg_in_data[r] = addr;
+            end
+            default: ;
+        endcase
+    endtask
+
+    // SCOREBOARD. At most one ALU read waits at a time, and only into a
+    // register or an ALU, which don't have side effects to order. Bundles
+    // don't, as their other move would have to wait along with it.
+    logic parked;
+    logic [$clog2(`NUM_ALUS)-1:0] parked_alu;
+    Unit parked_dst_unit;
+    logic [11:0] parked_dst_immediate;
+    logic [31:0] parked_start_pc;
+    assign pending_o = parked;
+
+    function automatic logic can_park(Unit dst);
+        return SCOREBOARD && !parked && !bundle && dst inside {UNIT_REGISTER, UNIT_ALU_LEFT, UNIT_ALU_RIGHT, UNIT_ALU_OPERATOR};
+    endfunction
+
+    // Whether an instruction must wait for the parked read to complete:
+    // because it touches the parked destination, changes the inputs of the
+    // ALU being read, or could observe the read not having retired yet.
+    function automatic logic conflicts(Unit su, logic [11:0] si, Unit du, logic [11:0] di);
+        if (su == UNIT_CONTROL || du == UNIT_CONTROL) return 1'b1;
+        if (du inside {UNIT_ALU_LEFT, UNIT_ALU_RIGHT, UNIT_ALU_OPERATOR} &&
+            di[$clog2(`NUM_ALUS)-1:0] == parked_alu) return 1'b1;
+        if (parked_dst_unit == UNIT_REGISTER)
+            return (su inside {UNIT_REGISTER, UNIT_REGISTER_POINTER} && si[4:0] == parked_dst_immediate[4:0]) ||
+                   (du inside {UNIT_REGISTER, UNIT_REGISTER_POINTER} && di[4:0] == parked_dst_immediate[4:0]);
+        return (su inside {UNIT_ALU_LEFT, UNIT_ALU_RIGHT, UNIT_ALU_RESULT} &&
+                si[$clog2(`NUM_ALUS)-1:0] == parked_dst_immediate[$clog2(`NUM_ALUS)-1:0]) ||
+               (du inside {UNIT_ALU_LEFT, UNIT_ALU_RIGHT, UNIT_ALU_OPERATOR} &&
+                di[$clog2(`NUM_ALUS)-1:0] == parked_dst_immediate[$clog2(`NUM_ALUS)-1:0]);
+    endfunction
+
+    // Guards. The value is taken from the inputs as the instruction starts,
+    // which waits for a guarding ALU that's still busy.
+    wire [$clog2(`NUM_ALUS)-1:0] guard_alu = guard_immediate_i[$clog2(`NUM_ALUS)-1:0];
+    wire [31:0] guard_value = guard_unit_i == UNIT_REGISTER ? reg_value[guard_immediate_i[4:0]] :
+                                                              alu_out_data[guard_alu];
+    wire guard_wait = guard_i && guard_unit_i != UNIT_REGISTER && alu_busy[guard_alu];
+    wire squash = guard_i && ((guard_value == 32'b0) != guard_invert_i);
+
+    wire blocked = exec_state == EXEC_START_SRC &&
+                   (guard_wait ||
+                    (parked && (conflicts(src_unit_i, src_immediate_i, dst_unit_i, dst_immediate_i) ||
+                                (bundle_i && conflicts(paired_src_unit_i, paired_src_immediate_i,
+                                                       paired_dst_unit_i, paired_dst_immediate_i)) ||
+                                (guard_i && conflicts(guard_unit_i, guard_immediate_i, UNIT_NONE, 12'b0)))));
+
+    // Write the parked read's destination, and retire it. retire_pc_o
+    // already covers it, as it was set when the read was parked;
+    // retire_start_pc_o is its own.
+    task complete_parked;
+        logic [31:0] value;
+        value = alu_out_data[parked_alu];
+        case (parked_dst_unit)
+            UNIT_REGISTER: begin
+                reg_unit_select[parked_dst_immediate] = 1'b1;
+                reg_unit_write[parked_dst_immediate] = 1'b1;
+                reg_in_data[parked_dst_immediate] = value;
+            end
+            UNIT_ALU_LEFT: alu_in_data_a[parked_dst_immediate] = value;
+            UNIT_ALU_RIGHT: alu_in_data_b[parked_dst_immediate] = value;
+            UNIT_ALU_OPERATOR: alu_operation[parked_dst_immediate] = ALU_OPERATOR'(value);
+            default: ;
+        endcase
+        retire_o <= 1'b1;
+        retire_src_unit_o <= UNIT_ALU_RESULT;
+        retire_dst_unit_o <= parked_dst_unit;
+        retire_start_pc_o <= parked_start_pc;
+        parked = 1'b0;
+    endtask
+
+    logic [31:0] dst_addr;
+    task write_dst;
+        case (dst_unit) inside
+            UNIT_REGISTER: begin
+                reg_unit_select[dst_immediate] = 1'b1;
+                reg_unit_write[dst_immediate] = 1'b1;
+                reg_in_data[dst_immediate] = src_value;
+                finish();
+            end
+            UNIT_ALU_LEFT: begin
+                alu_in_data_a[dst_immediate] = src_value;
+                finish();
+            end
+            UNIT_ALU_RIGHT: begin
+                alu_in_data_b[dst_immediate] = src_value;
+                finish();
+            end
+            UNIT_ALU_OPERATOR: begin
+                alu_operation[dst_immediate] = ALU_OPERATOR'(src_value);
+                finish();
+            end
+            UNIT_PC: begin
+                pc = src_value;
+                pc_write_o <= 1'b1;
+                pc_value_o <= src_value;
+                finish();
+            end
+            UNIT_STACK_PUSH_POP: begin
+                stack[stack_ptr] = src_value;
+                stack_ptr = stack_ptr + 1;
+                finish();
+            end
+            UNIT_STACK_INDEX: begin
+                stack[stack_index(dst_immediate)] = src_value;
+                finish();
+            end
+            UNIT_CONTROL: begin
+                ctrl_write_o <= 1'b1;
+                ctrl_write_addr_o <= dst_immediate;
+                ctrl_write_data_o <= src_value;
+                finish();
+            end
+            UNIT_MEMORY_OPERAND, UNIT_MEMORY_IMMEDIATE, UNIT_REGISTER_POINTER: begin
+                case (dst_unit)
+                    UNIT_MEMORY_OPERAND: dst_addr = dst_operand;
+                    UNIT_MEMORY_IMMEDIATE: dst_addr = dst_immediate;
+                    UNIT_REGISTER_POINTER: pointer_access(dst_immediate, dst_addr);
+                endcase
+                data_bus.addr = word_addr(mem_width(dst_unit, dst_immediate), dst_addr);
+                data_bus.valid = 1'b1;
+                data_bus.write_data = store_data(mem_width(dst_unit, dst_immediate), src_value);
+                data_bus.wstrb = store_strobe(mem_width(dst_unit, dst_immediate), dst_addr);
+                exec_state = EXEC_DST_MEM_STORE;
+            end
+            default:
+                finish();
+
+        endcase
+    endtask
+
     always @(posedge clk_i) begin
+        ctrl_write_o <= 1'b0;
+        pc_write_o <= 1'b0;
+        retire_o <= 1'b0;
         if (rst_i) begin
             reg_unit_select = '{default:1'b0};
             reg_unit_write = '{default:1'b0};
 
-            alu_select = '{default:1'b0};
             alu_operation = '{default:ALU_NOP};
             done_o = 1'b0;
-        end else if (sel_i) begin
+            issued_o = 1'b0;
+            exec_state = EXEC_START_SRC;
+            stack_ptr = '0;
+            parked = 1'b0;
+            bundle = 1'b0;
+            retire_pc_o <= 32'b0;
+            retire_start_pc_o <= 32'b0;
+        end else if (parked && !alu_busy[parked_alu]) begin
+            // Takes the cycle, so only one instruction retires per cycle.
+            complete_parked();
+        end else if (run && blocked) begin
+            // Hold the sequencer (non-pipelined) until the next instruction
+            // can go.
+            done_o = 1'b0;
+        end else if (run) begin
             case (exec_state)
                 EXEC_START_SRC: begin
+                    issued_o = issue_i;
+                    src_unit = src_unit_i;
+                    src_immediate = src_immediate_i;
+                    src_operand = src_operand_i;
+                    dst_unit = dst_unit_i;
+                    dst_immediate = dst_immediate_i;
+                    dst_operand = dst_operand_i;
+                    pc = pc_i;
+                    start_pc = start_pc_i;
+                    bundle = bundle_i;
+                    paired_src_unit = paired_src_unit_i;
+                    paired_src_immediate = paired_src_immediate_i;
+                    paired_dst_unit = paired_dst_unit_i;
+                    paired_dst_immediate = paired_dst_immediate_i;
+                    if (bundle) paired_value = paired_source();
+
                     done_o = 1'b0;
                     reg_unit_select = '{default:1'b0};
                     reg_unit_write = '{default:1'b0};
-                    alu_select = '{default:1'b0};
                     data_bus.valid = 1'b0;
                     data_bus.wstrb = 4'b0000;
                     data_bus.instr = 1'b0;
-                    case (src_unit_i) inside
+                    if (squash) squash_instruction();
+                    else case (src_unit) inside
                         // Start source memory retrieval
                         UNIT_MEMORY_OPERAND, UNIT_MEMORY_IMMEDIATE, UNIT_REGISTER_POINTER: begin
-                            case (src_unit_i)
-                                UNIT_MEMORY_OPERAND: data_bus.addr = src_operand_i;
-                                UNIT_MEMORY_IMMEDIATE: data_bus.addr = src_immediate_i;
-                                UNIT_REGISTER_POINTER: begin
-                                    reg_unit_select[src_immediate_i] = 1'b1;
-                                    data_bus.addr = reg_out_data[src_immediate_i];
-                                end
+                            case (src_unit)
+                                UNIT_MEMORY_OPERAND: src_addr = src_operand;
+                                UNIT_MEMORY_IMMEDIATE: src_addr = src_immediate;
+                                UNIT_REGISTER_POINTER: pointer_access(src_immediate, src_addr);
                             endcase
+                            src_width = mem_width(src_unit, src_immediate);
+                            data_bus.addr = word_addr(src_width, src_addr);
                             data_bus.valid = 1'b1;
                             exec_state = EXEC_SRC_MEM_RETRIEVE;
                         end
                         UNIT_REGISTER: begin
-                            reg_unit_select[src_immediate_i] = 1'b1;
-                            src_value = reg_out_data[src_immediate_i];
+                            src_value = reg_value[src_immediate];
                             exec_state = EXEC_START_DST;
                         end
                         UNIT_ALU_LEFT: begin
-                            src_value = alu_in_data_a[src_immediate_i];
+                            src_value = alu_in_data_a[src_immediate];
                             exec_state = EXEC_START_DST;
                         end
                         UNIT_ALU_RIGHT: begin
-                            src_value = alu_in_data_b[src_immediate_i];
+                            src_value = alu_in_data_b[src_immediate];
                             exec_state = EXEC_START_DST;
                         end
                         UNIT_ALU_RESULT: begin
-                            alu_select[src_immediate_i] = 1'b1;
-                            exec_state = EXEC_SRC_ALU_RETRIEVE;
+                            if (alu_busy[src_immediate] && can_park(dst_unit)) begin
+                                parked = 1'b1;
+                                parked_alu = src_immediate[$clog2(`NUM_ALUS)-1:0];
+                                parked_dst_unit = dst_unit;
+                                parked_dst_immediate = dst_immediate;
+                                parked_start_pc = start_pc;
+                                done_o = 1'b1;
+                                retire_pc_o <= pc;
+                                exec_state = EXEC_START_SRC;
+                            end else if (alu_busy[src_immediate]) exec_state = EXEC_SRC_ALU_RETRIEVE;
+                            else begin
+                                src_value = alu_out_data[src_immediate];
+                                exec_state = EXEC_START_DST;
+                            end
                         end
                         UNIT_ABS_IMMEDIATE: begin
-                            src_value = src_immediate_i;
+                            src_value = src_immediate;
                             exec_state = EXEC_START_DST;
                         end
                         UNIT_ABS_OPERAND: begin
-                            src_value = src_operand_i;
+                            src_value = src_operand;
+                            exec_state = EXEC_START_DST;
+                        end
+                        UNIT_CONTROL: begin
+                            src_value = ctrl_read_data_i;
                             exec_state = EXEC_START_DST;
                         end
                         UNIT_PC: begin
-                            src_value = pc_i;
+                            src_value = pc;
+                            exec_state = EXEC_START_DST;
+                        end
+                        UNIT_STACK_PUSH_POP: begin
+                            stack_ptr = stack_ptr - 1;
+                            src_value = stack[stack_ptr];
+                            exec_state = EXEC_START_DST;
+                        end
+                        UNIT_STACK_INDEX: begin
+                            src_value = stack[stack_index(src_immediate)];
+                            exec_state = EXEC_START_DST;
                         end
                         UNIT_NONE: begin
                             src_value = 32'b0;
-                            // Don't waste an extra clock cycle on no-op instructions.
-                            if (dst_unit_i != UNIT_NONE) exec_state = EXEC_START_DST;
+                            exec_state = EXEC_START_DST;
                         end
                         default: exec_state = EXEC_START_DST;
-
-                        // TODO: stack
                     endcase
 
+                    // Sources above which didn't need to wait for anything are ready now.
+                    // Unless it's going to the data bus, the destination can be written in
+                    // the same cycle.
+                    if (exec_state == EXEC_START_DST && ~is_memory(dst_unit)) write_dst();
+
                 end
                 EXEC_SRC_MEM_RETRIEVE: begin
                     if (data_bus.ready) begin
-                        src_value = data_bus.read_data;
+                        src_value = load_data(src_width, src_addr, data_bus.read_data);
                         data_bus.valid = 1'b0;
                         exec_state = EXEC_START_DST;
                     end
                 end
                 EXEC_SRC_ALU_RETRIEVE: begin
-                    src_value = alu_out_data[src_immediate_i];
-                    exec_state = EXEC_START_DST;
+                    if (!alu_busy[src_immediate]) begin
+                        src_value = alu_out_data[src_immediate];
+                        exec_state = EXEC_START_DST;
+                    end
                 end
-                // TODO: In some cases we might not need to wait on another cycle before performing
-                // the destination. Look to optimize for that by moving the state machine along
-                // without waiting for the next clock in those cases.
-                // Register to register for example should be one cycle.
-                EXEC_START_DST: begin
-                    case (dst_unit_i) inside
-                        UNIT_REGISTER: begin
-                            reg_unit_select[dst_immediate_i] = 1'b1;
-                            reg_unit_write[dst_immediate_i] = 1'b1;
-                            reg_in_data[dst_immediate_i] = src_value;
-                            begin
-                                done_o = 1'b1;
-                                exec_state = EXEC_START_SRC;
-                            end
-                        end
-                        UNIT_ALU_LEFT: begin
-                            alu_in_data_a[dst_immediate_i] = src_value;
-                            begin
-                                done_o = 1'b1;
-                                exec_state = EXEC_START_SRC;
-                            end
-                        end
-                        UNIT_ALU_RIGHT: begin
-                            alu_in_data_b[dst_immediate_i] = src_value;
-                            begin
-                                done_o = 1'b1;
-                                exec_state = EXEC_START_SRC;
-                            end
-                        end
-                        UNIT_ALU_OPERATOR: begin
-                            alu_operation[dst_immediate_i] = ALU_OPERATOR'(src_value);
-                            begin
-                                done_o = 1'b1;
-                                exec_state = EXEC_START_SRC;
-                            end
-                        end
-                        UNIT_MEMORY_OPERAND, UNIT_MEMORY_IMMEDIATE: begin
-                            case (dst_unit_i)
-                                UNIT_MEMORY_OPERAND: data_bus.addr = dst_operand_i;
-                                UNIT_MEMORY_IMMEDIATE: data_bus.addr = dst_immediate_i;
-                                UNIT_REGISTER_POINTER: begin
-                                    reg_unit_select[src_immediate_i] = 1'b1;
-                                    data_bus.addr = reg_out_data[src_immediate_i];
-                                end
-                            endcase
-
-
-                            data_bus.valid = 1'b1;
-                            data_bus.write_data = src_value;
-                            data_bus.wstrb = 4'b1111; // TODO... hm..
-                            begin
-                                done_o = 1'b1;
-                                exec_state = EXEC_START_SRC;
-                            end
-                        end
-                        default:
-                            begin
-                                done_o = 1'b1;
-                                exec_state = EXEC_START_SRC;
-                            end
-
-                    endcase
-
+                EXEC_START_DST: write_dst();
+                // The store stays on the bus until it's taken, once: a full
+                // console holds it, and the instruction with it.
+                EXEC_DST_MEM_STORE: begin
+                    if (data_bus.ready) begin
+                        data_bus.valid = 1'b0;
+                        data_bus.wstrb = 4'b0000;
+                        finish();
+                    end
                 end
             endcase
         end
@@ -0,0 +1,34 @@
+`include "common.vh"
+
+// Sends data bus requests from BASE up to io_bus, and the rest to mem_bus.
+// Neither side may keep requests outstanding, so the response is always from
+// wherever the request on cpu_bus is going. Chained, it splits the devices
+// from each other too.
+module io_split #(
+    parameter logic [31:0] BASE = `IO_BASE
+) (
+    bus_if.slave cpu_bus,
+    bus_if.master mem_bus,
+    bus_if.master io_bus
+);
+    wire io = cpu_bus.addr >= BASE;
+
+    always_comb begin
+        mem_bus.wstrb = cpu_bus.wstrb;
+        mem_bus.write_data = cpu_bus.write_data;
+        mem_bus.addr = cpu_bus.addr;
+        mem_bus.valid = cpu_bus.valid && !io;
+        mem_bus.instr = cpu_bus.instr;
+
+        io_bus.wstrb = cpu_bus.wstrb;
+        io_bus.write_data = cpu_bus.write_data;
+        io_bus.addr = cpu_bus.addr;
+        io_bus.valid = cpu_bus.valid && io;
+        io_bus.instr = cpu_bus.instr;
+
+        cpu_bus.accept = io ? io_bus.accept : mem_bus.accept;
+        cpu_bus.ready = io ? io_bus.ready : mem_bus.ready;
+        cpu_bus.read_data = io ? io_bus.read_data : mem_bus.read_data;
+    end
+
+endmodule : io_split
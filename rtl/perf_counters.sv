@@ -0,0 +1,72 @@
+`include "common.vh"
+
+// Performance counters, read and written as control registers through
+// UNIT_CONTROL. See ControlReg in common.vh for the map.
+module perf_counters(
+    input wire clk_i,
+    input wire rst_i,
+
+    // Events. retire_i strobes once per instruction, with its units.
+    input wire retire_i,
+    input Unit src_unit_i,
+    input Unit dst_unit_i,
+    input wire data_stall_i,
+
+    input wire [11:0] read_addr_i,
+    output logic [31:0] read_data_o,
+
+    input wire write_i,
+    input wire [11:0] write_addr_i,
+    input wire [31:0] write_data_i
+);
+    logic [31:0] cycles;
+    logic [31:0] instret;
+    logic [31:0] operand_fetches;
+    logic [31:0] data_stalls;
+    logic [31:0] alu_reads;
+
+    function automatic logic has_operand(Unit u);
+        return u == UNIT_MEMORY_OPERAND || u == UNIT_ABS_OPERAND;
+    endfunction
+
+    always @(posedge clk_i) begin
+        if (rst_i) begin
+            cycles = 32'b0;
+            instret = 32'b0;
+            operand_fetches = 32'b0;
+            data_stalls = 32'b0;
+            alu_reads = 32'b0;
+        end else begin
+            cycles = cycles + 1;
+            if (data_stall_i) data_stalls = data_stalls + 1;
+            if (retire_i) begin
+                instret = instret + 1;
+                operand_fetches = operand_fetches + has_operand(src_unit_i) + has_operand(dst_unit_i);
+                if (src_unit_i == UNIT_ALU_RESULT) alu_reads = alu_reads + 1;
+            end
+
+            if (write_i) begin
+                case (write_addr_i)
+                    CTRL_PERF_CYCLES: cycles = write_data_i;
+                    CTRL_PERF_INSTRET: instret = write_data_i;
+                    CTRL_PERF_OPERAND_FETCHES: operand_fetches = write_data_i;
+                    CTRL_PERF_DATA_STALLS: data_stalls = write_data_i;
+                    CTRL_PERF_ALU_READS: alu_reads = write_data_i;
+                    default: ;
+                endcase
+            end
+        end
+    end
+
+    always_comb begin
+        case (read_addr_i)
+            CTRL_PERF_CYCLES: read_data_o = cycles;
+            CTRL_PERF_INSTRET: read_data_o = instret;
+            CTRL_PERF_OPERAND_FETCHES: read_data_o = operand_fetches;
+            CTRL_PERF_DATA_STALLS: read_data_o = data_stalls;
+            CTRL_PERF_ALU_READS: read_data_o = alu_reads;
+            default: read_data_o = 32'b0;
+        endcase
+    end
+
+endmodule : perf_counters
@@ -0,0 +1,104 @@
+// Streams sequential instruction words from mem_bus ahead of the sequencer,
+// and answers cpu_bus from them without waiting on memory.
+//
+// The buffer holds the DEPTH words following the last one requested; word A
+// lives in slot A % DEPTH. A request inside that window is answered
+// combinationally, and retires the words before it to make room. Anything
+// else (a jump) empties the buffer and restarts streaming from the requested
+// address, as does flush_i, which the core raises on PC writes so the target
+// starts arriving before the sequencer asks for it.
+//
+// mem_bus follows accept (see bus_if.sv), so against a pipelined slave a new
+// fetch goes out every cycle. It's driven with non-blocking assignments, so
+// the slave sees the request it accepted whichever block runs first.
+module prefetch_buffer #(
+    parameter DEPTH = 4  // Power of two, at least 2
+) (
+    input wire clk_i,
+    input wire rst_i,
+
+    input wire flush_i,
+    input wire [31:0] flush_addr_i,
+
+    bus_if.slave cpu_bus,
+    bus_if.master mem_bus
+);
+    localparam INDEX_BITS = $clog2(DEPTH);
+
+    logic [31:0] words[DEPTH-1:0];
+    logic [31:0] head_addr;  // Address of the oldest word held
+    logic [31:0] count;      // Words held, from head_addr
+    // Fetches presented and not yet answered, the first discard of which are
+    // from before a restart and get dropped. The rest are for the words
+    // following those held.
+    logic [31:0] pending;
+    logic [31:0] discard;
+
+    // Combinational, for the sequencer. The clocked block below works on
+    // its own up-to-date copy.
+    wire [31:0] offset = cpu_bus.addr - head_addr;
+    assign cpu_bus.ready = cpu_bus.valid && offset < count;
+    assign cpu_bus.read_data = words[cpu_bus.addr[INDEX_BITS-1:0]];
+
+    task restart(input [31:0] addr);
+        head_addr = addr;
+        count = 32'b0;
+        discard = pending;
+    endtask
+
+    logic [31:0] request_offset;
+    logic [31:0] coming;  // Words held or on their way
+    logic [31:0] fill_addr;
+    always @(posedge clk_i) begin
+        if (rst_i) begin
+            head_addr = 32'b0;
+            count = 32'b0;
+            pending = 32'b0;
+            discard = 32'b0;
+            mem_bus.valid <= 1'b0;
+            mem_bus.wstrb <= 4'b0000;
+            mem_bus.write_data <= 32'b0;
+            mem_bus.instr <= 1'b1;
+        end else begin
+            // Responses arrive in order, so this one is for the oldest fetch
+            // still pending.
+            if (mem_bus.ready && pending != 0) begin
+                if (discard != 0) discard = discard - 1;
+                else begin
+                    fill_addr = head_addr + count;
+                    words[fill_addr[INDEX_BITS-1:0]] = mem_bus.read_data;
+                    count = count + 1;
+                end
+                pending = pending - 1;
+            end
+
+            request_offset = cpu_bus.addr - head_addr;
+            coming = count + pending - discard;
+            if (flush_i) restart(flush_addr_i);
+            else if (cpu_bus.valid) begin
+                if (request_offset <= coming) begin
+                    // Held, or on its way. Everything before it has been
+                    // used, including any fetches for it still to arrive.
+                    if (request_offset <= count) count = count - request_offset;
+                    else begin
+                        discard = discard + request_offset - count;
+                        count = 32'b0;
+                    end
+                    head_addr = cpu_bus.addr;
+                end else restart(cpu_bus.addr);
+            end
+
+            // A request can't be withdrawn once presented, so hold it until
+            // it's accepted.
+            coming = count + pending - discard;
+            if (!mem_bus.valid || mem_bus.accept) begin
+                if (coming < DEPTH) begin
+                    mem_bus.addr <= head_addr + coming;
+                    mem_bus.valid <= 1'b1;
+                    pending = pending + 1;
+                end else mem_bus.valid <= 1'b0;
+            end
+        end
+    end
+
+endmodule : prefetch_buffer
@@ -4,18 +4,17 @@ module register_unit(
     input wire sel_i,
     input wire wstrb_i,
     input logic [31:0] data_i,
-    output logic [31:0] data_o
+
+    // The read port: current contents, so a move can read a register in the
+    // same cycle as it writes another.
+    output wire [31:0] value_o
 );
     reg [31:0] r;
+    assign value_o = r;
 
     always @(posedge clk_i) begin
         if (rst_i) r <= 32'b0;
-        else if (sel_i) begin
-            if (wstrb_i) begin
-                r <= data_i;
-            end
-            data_o <= r;
-        end
+        else if (sel_i && wstrb_i) r <= data_i;
     end
 
 endmodule : register_unit
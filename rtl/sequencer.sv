@@ -1,8 +1,17 @@
-module sequencer(
+`include "common.vh"
+
+module sequencer #(
+    // Fetch the next instruction while execute runs the current one. See
+    // tta.sv.
+    parameter PIPELINED = 0
+) (
     input wire clk_i,
     input wire rst_i,
     bus_if.master instr_bus,
     output logic [31:0] pc_o,
+    // Where the instruction last issued starts: its bundle header, if it
+    // has one. It changes along with pc_o, as the instruction is issued.
+    output logic [31:0] start_pc_o,
     output logic [31:0] op_o,
     output logic [31:0] src_operand_o,
     output logic [31:0] dst_operand_o,
@@ -12,9 +21,33 @@ module sequencer(
     input logic sel_i,
     output wire decoder_enable_o,
 
+    // Flips the clock after each instruction is ready (PIPELINED), once the
+    // decoder outputs have settled. Execute has taken it once issued_i
+    // matches.
+    output logic issue_o,
+    input wire issued_i,
+
+    // Jump to pc_value_i.
+    input wire pc_write_i,
+    input wire [31:0] pc_value_i,
+
+    // The hardware loop's control registers (CTRL_LOOP_*), written by
+    // execute through UNIT_CONTROL.
+    input wire ctrl_write_i,
+    input wire [11:0] ctrl_write_addr_i,
+    input wire [31:0] ctrl_write_data_i,
+    output logic [31:0] loop_start_o,
+    output logic [31:0] loop_end_o,
+    output logic [31:0] loop_count_o,
+    // And the interrupt unit's (CTRL_IRQ_*), with its lines.
+    input wire [7:0] irq_i,
+    output logic [7:0] irq_enable_o,
+    output logic [31:0] irq_vector_o,
+    output logic [31:0] irq_epc_o,
+
     output logic done_o
 );
-    enum {
+    typedef enum {
         SEQ_START,
         SEQ_READ_OPCODE,
         SEQ_DECODE,
@@ -23,20 +56,96 @@ module sequencer(
         SEQ_READ_SRC_OPERAND_START,
         SEQ_READ_SRC_OPERAND,
         SEQ_READ_DST_OPERAND_START,
-        SEQ_READ_DST_OPERAND
-    } sequencer_state;
+        SEQ_READ_DST_OPERAND,
+        SEQ_BRANCH_WAIT
+    } SeqState;
+    SeqState sequencer_state;
 
     assign decoder_enable_o = sequencer_state == SEQ_DECODE;
 
+    // Instructions which write the PC, or the interrupt registers. Nothing
+    // after them is fetched until execute has written it, so an interrupt
+    // is never taken on a stale enable or vector.
+    wire irq_reg = Unit'(op_o[19:16]) == UNIT_CONTROL && {op_o[31:24], 4'b0} == CTRL_IRQ_ENABLE;
+    wire writes_pc = Unit'(op_o[19:16]) == UNIT_PC;
+    wire branch = writes_pc || irq_reg;
+    // Bundle headers are left to the decoder, and the instruction they go
+    // with fetched straight away.
+    wire header = Unit'(op_o[3:0]) == UNIT_BUNDLE;
+    SeqState next_state;
+    assign next_state = branch ? SEQ_BRANCH_WAIT : SEQ_START;
+
+    // Where the instruction being fetched starts.
+    logic [31:0] instr_start;
+
+    // Move past a finished instruction of n words. While the loop count is
+    // non-zero, reaching the loop end counts it down and, unless that was
+    // the last time around, goes back to the loop start instead. PC writes
+    // are left alone, and so leave the loop as they please.
+    task advance(input [31:0] n);
+        start_pc_o = instr_start;
+        pc_o = pc_o + n;
+        if (!writes_pc && loop_count_o != 0 && pc_o == loop_end_o) begin
+            loop_count_o = loop_count_o - 1;
+            if (loop_count_o != 0) pc_o = loop_start_o;
+        end
+    endtask
+
+    // In pipelined mode, hold a finished instruction until execute has
+    // taken it; otherwise the caller pauses the sequencer through sel_i.
+    wire run = PIPELINED ? ~(done_o && issue_o != issued_i) : sel_i;
+
+    // Set from entering an interrupt handler until it returns.
+    logic irq_active;
+
     always @(posedge clk_i) begin
         if (rst_i) begin
             pc_o = 32'b0;
+            start_pc_o = 32'b0;
+            instr_start = 32'b0;
             op_o = 32'b0;
             sequencer_state = SEQ_START;
             instr_bus.valid = 1'b0;
-        end else if (sel_i) begin
-            case (sequencer_state)
+            issue_o <= 1'b0;
+            done_o = 1'b0;
+            loop_start_o = 32'b0;
+            loop_end_o = 32'b0;
+            loop_count_o = 32'b0;
+            irq_enable_o = 8'b0;
+            irq_vector_o = 32'b0;
+            irq_epc_o = 32'b0;
+            irq_active = 1'b0;
+        end else begin
+            if (ctrl_write_i) case (ctrl_write_addr_i)
+                CTRL_LOOP_START: loop_start_o = ctrl_write_data_i;
+                CTRL_LOOP_END: loop_end_o = ctrl_write_data_i;
+                CTRL_LOOP_COUNT: loop_count_o = ctrl_write_data_i;
+                CTRL_IRQ_ENABLE: irq_enable_o = ctrl_write_data_i[7:0];
+                CTRL_IRQ_VECTOR: irq_vector_o = ctrl_write_data_i;
+                CTRL_IRQ_EPC: irq_epc_o = ctrl_write_data_i;
+                CTRL_IRQ_RETURN: begin
+                    pc_o = irq_epc_o;
+                    irq_active = 1'b0;
+                end
+                default: ;
+            endcase
+            if (ctrl_write_i && {ctrl_write_addr_i[11:4], 4'b0} == CTRL_IRQ_ENABLE &&
+                sequencer_state == SEQ_BRANCH_WAIT)
+                sequencer_state = SEQ_START;
+            if (pc_write_i) begin
+                pc_o = pc_value_i;
+                if (sequencer_state == SEQ_BRANCH_WAIT) sequencer_state = SEQ_START;
+            end
+            if (run) case (sequencer_state)
                 SEQ_START: begin
+                    // Only ever between instructions, headers included, and
+                    // costing no cycles of its own.
+                    if (!irq_active && (irq_i & irq_enable_o) != 8'b0) begin
+                        irq_epc_o = pc_o;
+                        pc_o = irq_vector_o;
+                        irq_active = 1'b1;
+                    end
+                    instr_start = pc_o;
                     instr_bus.valid = 1'b1;
                     instr_bus.instr = 1'b1;
                     instr_bus.addr = pc_o;
@@ -50,7 +159,13 @@ module sequencer(
                     end
                 end
                 SEQ_DECODE: begin
-                    if (need_src_operand_i || need_dst_operand_i) begin
+                    if (header) begin
+                        pc_o = pc_o + 1;
+                        instr_bus.valid = 1'b1;
+                        instr_bus.instr = 1'b1;
+                        instr_bus.addr = pc_o;
+                        sequencer_state = SEQ_READ_OPCODE;
+                    end else if (need_src_operand_i || need_dst_operand_i) begin
                         instr_bus.valid = 1'b1;
                         instr_bus.instr = 1'b0;
                         instr_bus.addr = pc_o + 1;
@@ -58,8 +173,9 @@ module sequencer(
                         else sequencer_state = SEQ_READ_DST_OPERAND;
                     end else begin
                         done_o = 1'b1;
-                        pc_o = pc_o + 1;
-                        sequencer_state = SEQ_START;
+                        issue_o <= ~issue_o;
+                        advance(1);
+                        sequencer_state = next_state;
                     end
                 end
                 SEQ_READ_SRC_OPERAND: begin
@@ -69,8 +185,9 @@ module sequencer(
                         if (need_dst_operand_i) sequencer_state = SEQ_READ_DST_OPERAND_START;
                         else begin
                             done_o = 1'b1;
-                            pc_o = pc_o + 1;
-                            sequencer_state = SEQ_START;
+                            issue_o <= ~issue_o;
+                            advance(1);
+                            sequencer_state = next_state;
                         end
                     end
                 end
@@ -83,13 +200,15 @@ module sequencer(
                 SEQ_READ_DST_OPERAND: begin
                     if (instr_bus.ready) begin
                         dst_operand_o = instr_bus.read_data;
-                        pc_o = pc_o + 2;
+                        advance(2);
                         done_o = 1'b1;
-                        sequencer_state = SEQ_START;
+                        issue_o <= ~issue_o;
+                        sequencer_state = next_state;
                     end
                 end
+                SEQ_BRANCH_WAIT: ;
             endcase
         end
     end
 
-endmodule : sequencer
\ No newline at end of file
+endmodule : sequencer
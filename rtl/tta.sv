@@ -1,32 +1,114 @@
 `include "common.vh"
-module tta(
+
+// PIPELINED overlaps fetch and decode of the next instruction with execution
+// of the current one. The sequencer then only waits on execute for
+// instructions which write the PC. pc_o is the PC following the last retired
+// instruction, rather than the sequencer's fetch address.
+//
+// PREFETCH_DEPTH, when non-zero, puts a prefetch_buffer of that many words
+// between the sequencer and instr_bus, so straight-line code is read ahead of
+// the sequencer asking for it.
+//
+// SCOREBOARD lets instructions after a read of a busy ALU go ahead of it when
+// they don't depend on it. See execute.sv.
+module tta #(
+    parameter PIPELINED = 0,
+    parameter PREFETCH_DEPTH = 0,
+    parameter SCOREBOARD = 0
+) (
     input wire rst_i,
     input wire clk_i,
 
     output wire instr_done_o,
+    // High for one cycle per instruction retired. Unlike instr_done_o, this
+    // still separates instructions which retire on consecutive cycles.
+    output wire instr_retired_o,
+    // High while an instruction is waiting on an ALU with others having
+    // retired after it (SCOREBOARD).
+    output wire instr_pending_o,
+    output wire [31:0] pc_o,
+    // Where the instruction retiring while instr_retired_o is high starts,
+    // whichever way the core is built.
+    output wire [31:0] retire_start_pc_o,
+    output wire [32*32-1:0] regs_o,
+
+    // Interrupt lines, see IrqSource.
+    input wire [7:0] irq_i,
 
     bus_if.master instr_bus,
     bus_if.master data_bus
 );
 
     logic [31:0] pc;
+    logic [31:0] start_pc;
     logic [31:0] src_operand;
     logic [31:0] dst_operand;
     logic [31:0] op;
     logic done_exec;
+    logic [31:0] retire_pc;
+    logic retire;
 
     assign instr_done_o = done_exec;
+    assign instr_retired_o = retire;
+    assign pc_o = PIPELINED ? retire_pc : pc;
 
     logic need_src_operand;
     logic need_dst_operand;
     logic decoder_enable;
     logic sequencer_done;
     wire pause_sequencer = sequencer_done && ~done_exec;
-    sequencer sequencer(
+    logic issue;
+    logic issued;
+    logic pc_write;
+    logic [31:0] pc_value;
+
+    wire [11:0] ctrl_read_addr;
+    logic [31:0] ctrl_read_data;
+    wire ctrl_write;
+    wire [11:0] ctrl_write_addr;
+    wire [31:0] ctrl_write_data;
+    logic [31:0] loop_start;
+    logic [31:0] loop_end;
+    logic [31:0] loop_count;
+    logic [7:0] irq_enable;
+    logic [31:0] irq_vector;
+    logic [31:0] irq_epc;
+
+    bus_if fetch_bus;
+    generate
+        if (PREFETCH_DEPTH > 0) begin : prefetch
+            prefetch_buffer #(
+                .DEPTH(PREFETCH_DEPTH)
+            ) prefetch_buffer(
+                .clk_i(clk_i),
+                .rst_i(rst_i),
+                .flush_i(pc_write),
+                .flush_addr_i(pc_value),
+                .cpu_bus(fetch_bus),
+                .mem_bus(instr_bus)
+            );
+        end else begin : no_prefetch
+            always_comb begin
+                instr_bus.wstrb = fetch_bus.wstrb;
+                instr_bus.write_data = fetch_bus.write_data;
+                instr_bus.addr = fetch_bus.addr;
+                instr_bus.valid = fetch_bus.valid;
+                instr_bus.instr = fetch_bus.instr;
+                fetch_bus.accept = instr_bus.accept;
+                fetch_bus.ready = instr_bus.ready;
+                fetch_bus.read_data = instr_bus.read_data;
+            end
+        end
+    endgenerate
+
+    sequencer #(
+        .PIPELINED(PIPELINED)
+    ) sequencer(
         .clk_i(clk_i),
         .rst_i(rst_i),
-        .instr_bus(instr_bus),
+        .instr_bus(fetch_bus),
         .pc_o(pc),
+        .start_pc_o(start_pc),
         .op_o(op),
         .sel_i(~pause_sequencer),
         .src_operand_o(src_operand),
@@ -34,12 +116,35 @@ module tta(
         .dst_operand_o(dst_operand),
         .decoder_enable_o(decoder_enable),
         .need_dst_operand_i(need_dst_operand),
+        .issue_o(issue),
+        .issued_i(issued),
+        .pc_write_i(pc_write),
+        .pc_value_i(pc_value),
+        .ctrl_write_i(ctrl_write),
+        .ctrl_write_addr_i(ctrl_write_addr),
+        .ctrl_write_data_i(ctrl_write_data),
+        .loop_start_o(loop_start),
+        .loop_end_o(loop_end),
+        .loop_count_o(loop_count),
+        .irq_i(irq_i),
+        .irq_enable_o(irq_enable),
+        .irq_vector_o(irq_vector),
+        .irq_epc_o(irq_epc),
         .done_o(sequencer_done)
     );
     Unit src_unit;
     Unit dst_unit;
     logic [11:0] si;
     logic [11:0] di;
+    logic bundle;
+    Unit paired_src_unit;
+    Unit paired_dst_unit;
+    logic [11:0] paired_si;
+    logic [11:0] paired_di;
+    logic guard;
+    Unit guard_unit;
+    logic [11:0] guard_immediate;
+    logic guard_invert;
 
     decoder decoder(
         .rst_i(rst_i),
@@ -51,13 +156,31 @@ module tta(
         .si_o(si),
         .dst_unit_o(dst_unit),
         .need_dst_operand_o(need_dst_operand),
-        .di_o(di)
+        .di_o(di),
+        .bundle_o(bundle),
+        .paired_src_unit_o(paired_src_unit),
+        .paired_si_o(paired_si),
+        .paired_dst_unit_o(paired_dst_unit),
+        .paired_di_o(paired_di),
+        .guard_o(guard),
+        .guard_unit_o(guard_unit),
+        .guard_immediate_o(guard_immediate),
+        .guard_invert_o(guard_invert)
     );
 
-    execute execute(
+    wire data_stall;
+    wire [7:0] alu_busy;
+    Unit retire_src_unit;
+    Unit retire_dst_unit;
+
+    execute #(
+        .PIPELINED(PIPELINED),
+        .SCOREBOARD(SCOREBOARD)
+    ) execute(
         .rst_i(rst_i),
         .clk_i(clk_i),
         .pc_i(pc),
+        .start_pc_i(start_pc),
         .sel_i(sequencer_done),
         .data_bus(data_bus),
         .src_unit_i(src_unit),
@@ -66,7 +189,66 @@ module tta(
         .dst_unit_i(dst_unit),
         .dst_immediate_i(di),
         .dst_operand_i(dst_operand),
-        .done_o(done_exec)
+        .bundle_i(bundle),
+        .paired_src_unit_i(paired_src_unit),
+        .paired_src_immediate_i(paired_si),
+        .paired_dst_unit_i(paired_dst_unit),
+        .paired_dst_immediate_i(paired_di),
+        .guard_i(guard),
+        .guard_unit_i(guard_unit),
+        .guard_immediate_i(guard_immediate),
+        .guard_invert_i(guard_invert),
+        .done_o(done_exec),
+        .issue_i(issue),
+        .issued_o(issued),
+        .pc_write_o(pc_write),
+        .pc_value_o(pc_value),
+        .retire_o(retire),
+        .retire_src_unit_o(retire_src_unit),
+        .retire_dst_unit_o(retire_dst_unit),
+        .retire_pc_o(retire_pc),
+        .retire_start_pc_o(retire_start_pc_o),
+        .ctrl_read_addr_o(ctrl_read_addr),
+        .ctrl_read_data_i(ctrl_read_data),
+        .ctrl_write_o(ctrl_write),
+        .ctrl_write_addr_o(ctrl_write_addr),
+        .ctrl_write_data_o(ctrl_write_data),
+        .data_stall_o(data_stall),
+        .alu_busy_o(alu_busy),
+        .pending_o(instr_pending_o),
+        .regs_o(regs_o)
+    );
+
+    // Control register reads: the ALU status and interrupt lines here, the
+    // loop and interrupt unit from the sequencer, the counters from
+    // perf_counters.
+    wire [31:0] perf_read_data;
+    always_comb begin
+        case (ctrl_read_addr)
+            CTRL_ALU_BUSY: ctrl_read_data = {24'b0, alu_busy};
+            CTRL_LOOP_START: ctrl_read_data = loop_start;
+            CTRL_LOOP_END: ctrl_read_data = loop_end;
+            CTRL_LOOP_COUNT: ctrl_read_data = loop_count;
+            CTRL_IRQ_ENABLE: ctrl_read_data = {24'b0, irq_enable};
+            CTRL_IRQ_PENDING: ctrl_read_data = {24'b0, irq_i};
+            CTRL_IRQ_VECTOR: ctrl_read_data = irq_vector;
+            CTRL_IRQ_EPC: ctrl_read_data = irq_epc;
+            default: ctrl_read_data = perf_read_data;
+        endcase
+    end
+
+    perf_counters perf_counters(
+        .clk_i(clk_i),
+        .rst_i(rst_i),
+        .retire_i(retire),
+        .src_unit_i(retire_src_unit),
+        .dst_unit_i(retire_dst_unit),
+        .data_stall_i(data_stall),
+        .read_addr_i(ctrl_read_addr),
+        .read_data_o(perf_read_data),
+        .write_i(ctrl_write),
+        .write_addr_i(ctrl_write_addr),
+        .write_data_i(ctrl_write_data)
     );
 
 endmodule : tta
\ No newline at end of file
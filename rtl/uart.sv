@@ -0,0 +1,106 @@
+`include "common.vh"
+
+// 8N1 serial port, CLKS_PER_BIT clocks a bit, with two registers on bus
+// (see UartReg in common.vh). Both registers answer straight away.
+//
+// Masters may hold a request for several cycles, so writes to UART_DATA are
+// only taken while the transmitter is idle, and reading it clears the
+// received flag however often it's read. Either way a repeat does nothing.
+//
+// rx_ready_o and tx_empty_o double as interrupt requests: a byte waiting to
+// be read, and the transmitter having nothing to send.
+module uart #(
+    parameter CLKS_PER_BIT = 651
+) (
+    input wire clk_i,
+    input wire rst_i,
+
+    bus_if.slave bus,
+
+    input wire rxd_i,
+    output logic txd_o,
+
+    output logic rx_ready_o,
+    output wire tx_empty_o
+);
+    localparam COUNT_BITS = $clog2(CLKS_PER_BIT + 1);
+
+    wire data_reg = bus.addr[0] == UART_DATA[0];
+
+    assign bus.ready = bus.valid;
+    assign bus.accept = bus.valid;
+
+    // Transmit: start bit, eight data bits from the bottom up, stop bit,
+    // shifted out of tx_shift.
+    logic [9:0] tx_shift;
+    logic [3:0] tx_bits_left;
+    logic [COUNT_BITS-1:0] tx_count;
+    assign tx_empty_o = tx_bits_left == 0;
+
+    // Receive. rxd_i is resynchronised, then sampled mid-bit from the
+    // falling edge of the start bit.
+    logic [1:0] rxd_sync;
+    logic [7:0] rx_data;
+    logic [7:0] rx_shift;
+    logic [3:0] rx_bits_left;
+    logic [COUNT_BITS-1:0] rx_count;
+
+    assign bus.read_data = data_reg ? {24'b0, rx_data} : {30'b0, tx_empty_o, rx_ready_o};
+
+    always @(posedge clk_i) begin
+        if (rst_i) begin
+            txd_o = 1'b1;
+            tx_bits_left = 4'd0;
+            tx_count = '0;
+            rxd_sync = 2'b11;
+            rx_data = 8'b0;
+            rx_ready_o = 1'b0;
+            rx_bits_left = 4'd0;
+            rx_count = '0;
+        end else begin
+            if (bus.valid && data_reg) begin
+                if (bus.wstrb[0] && tx_empty_o) begin
+                    tx_shift = {1'b1, bus.write_data[7:0], 1'b0};
+                    tx_bits_left = 4'd10;
+                    tx_count = '0;
+                end else if (bus.wstrb == 4'b0) rx_ready_o = 1'b0;
+            end
+
+            if (tx_bits_left != 0) begin
+                if (tx_count == 0) begin
+                    txd_o = tx_shift[0];
+                    tx_shift = tx_shift >> 1;
+                    tx_count = CLKS_PER_BIT - 1;
+                end else begin
+                    tx_count = tx_count - 1;
+                    // The stop bit has had its time.
+                    if (tx_count == 0) tx_bits_left = tx_bits_left - 1;
+                end
+            end
+
+            rxd_sync = {rxd_sync[0], rxd_i};
+            if (rx_bits_left == 0) begin
+                if (!rxd_sync[1]) begin
+                    rx_bits_left = 4'd10;
+                    rx_count = CLKS_PER_BIT / 2;
+                end
+            end else if (rx_count != 0) rx_count = rx_count - 1;
+            else begin
+                rx_count = CLKS_PER_BIT - 1;
+                rx_bits_left = rx_bits_left - 1;
+                case (rx_bits_left)
+                    // A start bit which didn't last was a glitch.
+                    4'd9: if (rxd_sync[1]) rx_bits_left = 4'd0;
+                    4'd0: begin
+                        if (rxd_sync[1]) begin
+                            rx_data = rx_shift;
+                            rx_ready_o = 1'b1;
+                        end
+                    end
+                    default: rx_shift = {rxd_sync[1], rx_shift[7:1]};
+                endcase
+            end
+        end
+    end
+
+endmodule : uart
@@ -1,5 +1,9 @@
 #include "assembler.h"
 
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
 namespace {
 
 bool NeedsOperand(Unit u) {
@@ -15,6 +19,8 @@ bool NeedsOperand(Unit u) {
     case Unit::UNIT_MEMORY_IMMEDIATE:
     case Unit::UNIT_PC:
     case Unit::UNIT_ABS_IMMEDIATE:
+    case Unit::UNIT_CONTROL:
+    case Unit::UNIT_BUNDLE:
       return false;
     case Unit::UNIT_MEMORY_OPERAND:
     case Unit::UNIT_ABS_OPERAND:
@@ -22,19 +28,210 @@ bool NeedsOperand(Unit u) {
   }
   return false;
 }
+std::string Hex(uint32_t v, int width) {
+  std::ostringstream o;
+  o << std::hex << std::setw(width) << std::setfill('0') << v;
+  return o.str();
+}
+
+std::string WidthSuffix(unsigned short i) {
+  switch ((MemWidth)(i >> 8)) {
+    case MemWidth::MEM_WORD:
+      return "";
+    case MemWidth::MEM_BYTE:
+      return ".b";
+    case MemWidth::MEM_BYTE_SIGNED:
+      return ".sb";
+    case MemWidth::MEM_HALF:
+      return ".h";
+    case MemWidth::MEM_HALF_SIGNED:
+      return ".sh";
+  }
+  return ".?";
+}
+
+std::string UnitName(Unit u,
+                     unsigned short i,
+                     const std::optional<uint32_t>& operand) {
+  switch (u) {
+    case Unit::UNIT_NONE:
+      return "_";
+    case Unit::UNIT_STACK_PUSH_POP:
+      return "STACK";
+    case Unit::UNIT_STACK_INDEX:
+      return "S" + Hex(i, 3);
+    case Unit::UNIT_REGISTER:
+      return "R" + Hex(i, 2);
+    case Unit::UNIT_ALU_LEFT:
+      return "ALU" + std::to_string(i) + ":LEFT";
+    case Unit::UNIT_ALU_RIGHT:
+      return "ALU" + std::to_string(i) + ":RIGHT";
+    case Unit::UNIT_ALU_OPERATOR:
+      return "ALU" + std::to_string(i) + ":OPERATOR";
+    case Unit::UNIT_ALU_RESULT:
+      return "ALU" + std::to_string(i) + ":RESULT";
+    case Unit::UNIT_MEMORY_IMMEDIATE:
+      return "*(" + Hex(i, 3) + ")";
+    case Unit::UNIT_MEMORY_OPERAND:
+      return "*(" + Hex(operand.value_or(0), 8) + ")" + WidthSuffix(i);
+    case Unit::UNIT_PC:
+      return "PC";
+    case Unit::UNIT_ABS_IMMEDIATE:
+      return "#" + Hex(i, 3);
+    case Unit::UNIT_ABS_OPERAND:
+      return "#" + Hex(operand.value_or(0), 8);
+    case Unit::UNIT_REGISTER_POINTER:
+      switch ((PtrMode)(i >> 6 & 3)) {
+        case PtrMode::PTR_POST_INC:
+          return "*R" + Hex(i & 0x1f, 2) + "++" + WidthSuffix(i);
+        case PtrMode::PTR_PRE_DEC:
+          return "*--R" + Hex(i & 0x1f, 2) + WidthSuffix(i);
+        default:
+          return "*R" + Hex(i & 0x1f, 2) + WidthSuffix(i);
+      }
+    case Unit::UNIT_CONTROL:
+      return "CTRL" + Hex(i, 3);
+    case Unit::UNIT_BUNDLE:
+      break;
+  }
+  return "?" + std::to_string((int)u);
+}
+
 }  // namespace
 
+Instr::OpFormat Instr::Decode(uint32_t op) {
+  static_assert(sizeof(OpFormat) == sizeof(uint32_t));
+  OpFormat f;
+  memcpy(&f, &op, sizeof(f));
+  return f;
+}
+
+Instr::PairFormat Instr::DecodePair(uint32_t header) {
+  static_assert(sizeof(PairFormat) == sizeof(uint32_t));
+  PairFormat f;
+  memcpy(&f, &header, sizeof(f));
+  return f;
+}
+
+Instr::GuardFormat Instr::DecodeGuard(uint32_t header) {
+  static_assert(sizeof(GuardFormat) == sizeof(uint32_t));
+  GuardFormat f;
+  memcpy(&f, &header, sizeof(f));
+  return f;
+}
+
+bool Instr::CanPair(const OpFormat& op) {
+  switch ((Unit)op.src_unit) {
+    case Unit::UNIT_NONE:
+    case Unit::UNIT_REGISTER:
+    case Unit::UNIT_ALU_LEFT:
+    case Unit::UNIT_ALU_RIGHT:
+    case Unit::UNIT_ABS_IMMEDIATE:
+      break;
+    default:
+      return false;
+  }
+  switch ((Unit)op.dst_unit) {
+    case Unit::UNIT_NONE:
+    case Unit::UNIT_REGISTER:
+    case Unit::UNIT_ALU_LEFT:
+    case Unit::UNIT_ALU_RIGHT:
+    case Unit::UNIT_ALU_OPERATOR:
+      break;
+    default:
+      return false;
+  }
+  return op.si < 1U << 8U && op.di < 1U << 8U;
+}
+
+Instr Instr::Disassemble(const uint32_t* code) {
+  Instr instr;
+  for (; IsHeader(*code); code++) {
+    switch (KindOf(*code)) {
+      case HeaderKind::HEADER_PAIR: {
+        const PairFormat h = DecodePair(*code);
+        OpFormat paired = {};
+        paired.src_unit = h.src_unit;
+        paired.si = h.si;
+        paired.dst_unit = h.dst_unit;
+        paired.di = h.di;
+        instr.paired_ = paired;
+      } break;
+      case HeaderKind::HEADER_GUARD:
+        instr.guard_ = DecodeGuard(*code);
+        break;
+    }
+  }
+  instr.op_ = Decode(*code++);
+  if (instr.UsesSoperand())
+    instr.soperand_ = *code++;
+  if (instr.UsesDoperand())
+    instr.doperand_ = *code++;
+  return instr;
+}
+
+size_t Instr::size() const {
+  return guard_.has_value() + paired_.has_value() + 1 + UsesSoperand() +
+         UsesDoperand();
+}
+
+std::string Instr::ToString() const {
+  std::string s;
+  if (guard_) {
+    s = std::string("(") + (guard_->invert ? "!" : "") +
+        UnitName((Unit)guard_->unit, guard_->index, {}) + ") ";
+  }
+  if (op_.src_unit == (int)Unit::UNIT_NONE &&
+      op_.dst_unit == (int)Unit::UNIT_NONE)
+    s += "NOP";
+  else
+    s += UnitName((Unit)op_.dst_unit, op_.di, doperand_) +
+         " := " + UnitName((Unit)op_.src_unit, op_.si, soperand_);
+  if (paired_) {
+    s += " || " + UnitName((Unit)paired_->dst_unit, paired_->di, {}) +
+         " := " + UnitName((Unit)paired_->src_unit, paired_->si, {});
+  }
+  return s;
+}
+
 std::vector<uint32_t> Instr::assemble() const {
+  std::vector<uint32_t> prg(size());
+  AssembleTo(prg.data());
+  return prg;
+}
+
+size_t Instr::AssembleTo(uint32_t* out) const {
   CHECK_EQ(UsesSoperand(), soperand_.has_value());
   CHECK_EQ(UsesDoperand(), doperand_.has_value());
 
-  std::vector<uint32_t> prg{*reinterpret_cast<const uint32_t*>(&op_)};
+  uint32_t* p = out;
+  if (guard_)
+    *p++ = EncodeGuard((Unit)guard_->unit, guard_->index, guard_->invert);
+  if (paired_)
+    *p++ = EncodePair((Unit)paired_->src_unit, paired_->si,
+                      (Unit)paired_->dst_unit, paired_->di);
+  *p++ = Encode((Unit)op_.src_unit, op_.si, (Unit)op_.dst_unit, op_.di);
   if (UsesSoperand())
-    prg.emplace_back(soperand_.value());
+    *p++ = *soperand_;
   if (UsesDoperand())
-    prg.emplace_back(doperand_.value());
+    *p++ = *doperand_;
+  return p - out;
+}
+
+size_t Instr::Assemble(const Program& program, uint32_t* out, size_t n) {
+  const size_t words = Size(program);
+  CHECK_LE(words, n) << "Program doesn't fit";
+  uint32_t* p = out;
+  for (const auto& instr : program)
+    p += instr.AssembleTo(p);
+  return p - out;
+}
 
-  return std::move(prg);
+size_t Instr::Size(const Program& program) {
+  size_t words = 0;
+  for (const auto& instr : program)
+    words += instr.size();
+  return words;
 }
 
 bool Instr::UsesSoperand() const {
@@ -69,6 +266,26 @@ Instr& Instr::Di(const short i) {
   return *this;
 }
 
+Instr& Instr::SrcWidth(MemWidth w) {
+  op_.si = (op_.si & 0xff) | (unsigned short)w << 8;
+  return *this;
+}
+
+Instr& Instr::DstWidth(MemWidth w) {
+  op_.di = (op_.di & 0xff) | (unsigned short)w << 8;
+  return *this;
+}
+
+Instr& Instr::SrcPtr(PtrMode m) {
+  op_.si = (op_.si & ~0xc0) | (unsigned short)m << 6;
+  return *this;
+}
+
+Instr& Instr::DstPtr(PtrMode m) {
+  op_.di = (op_.di & ~0xc0) | (unsigned short)m << 6;
+  return *this;
+}
+
 Instr& Instr::Soperand(uint32_t o) {
   CHECK(UsesSoperand());
   soperand_ = o;
@@ -79,3 +296,45 @@ Instr& Instr::Doperand(uint32_t o) {
   doperand_ = o;
   return *this;
 }
+
+Instr& Instr::Push() {
+  return Dst(Unit::UNIT_STACK_PUSH_POP);
+}
+
+Instr& Instr::Pop() {
+  return Src(Unit::UNIT_STACK_PUSH_POP);
+}
+
+Instr& Instr::Poke(short n) {
+  return Dst(Unit::UNIT_STACK_INDEX).Di(n);
+}
+
+Instr& Instr::Peek(short n) {
+  return Src(Unit::UNIT_STACK_INDEX).Si(n);
+}
+
+Instr& Instr::Pair(const Instr& other) {
+  CHECK(CanPair(other.op_)) << other.ToString() << " can't be bundled";
+  CHECK(!other.paired_);
+  CHECK_NE(op_.src_unit, (unsigned short)Unit::UNIT_BUNDLE);
+  paired_ = other.op_;
+  return *this;
+}
+
+Instr& Instr::If(Unit u, short r) {
+  CHECK(u == Unit::UNIT_REGISTER || u == Unit::UNIT_ALU_RESULT);
+  CHECK_LT(r, 1 << 8);
+  GuardFormat g = {};
+  g.bundle = (unsigned)Unit::UNIT_BUNDLE;
+  g.unit = (unsigned)u;
+  g.index = r;
+  g.kind = (unsigned)HeaderKind::HEADER_GUARD;
+  guard_ = g;
+  return *this;
+}
+
+Instr& Instr::IfNot(Unit u, short r) {
+  If(u, r);
+  guard_->invert = 1;
+  return *this;
+}
@@ -4,6 +4,7 @@
 
 #include <cstdint>
 #include <optional>
+#include <string>
 #include <vector>
 
 enum class ALUOp {
@@ -40,13 +41,159 @@ enum class Unit {
   UNIT_ABS_IMMEDIATE = 11,
   UNIT_ABS_OPERAND = 12,
   UNIT_REGISTER_POINTER = 13,
+  UNIT_CONTROL = 14,
+  // Not a move: a bundle header, see Instr::Pair().
+  UNIT_BUNDLE = 15,
+};
+
+// Access width for UNIT_MEMORY_OPERAND and UNIT_REGISTER_POINTER, in bits
+// [11:8] of their immediate, see rtl/common.vh. Everything but MEM_WORD takes
+// a byte address.
+enum class MemWidth {
+  MEM_WORD = 0x0,
+  MEM_BYTE = 0x1,
+  MEM_BYTE_SIGNED = 0x2,
+  MEM_HALF = 0x3,
+  MEM_HALF_SIGNED = 0x4,
+};
+
+// Pointer update for UNIT_REGISTER_POINTER, in bits [7:6] of its immediate,
+// see rtl/common.vh. Steps by 2 for halfwords and 1 otherwise.
+enum class PtrMode {
+  PTR_PLAIN = 0x0,
+  PTR_POST_INC = 0x1,
+  PTR_PRE_DEC = 0x2,
+};
+
+// Kinds of UNIT_BUNDLE header word, in bits [31:28], see rtl/common.vh.
+enum class HeaderKind {
+  HEADER_PAIR = 0x0,
+  HEADER_GUARD = 0x1,
+};
+
+// Registers reachable through UNIT_CONTROL, see rtl/common.vh.
+enum class ControlReg {
+  CTRL_PERF_CYCLES = 0x000,
+  CTRL_PERF_INSTRET = 0x001,
+  CTRL_PERF_OPERAND_FETCHES = 0x002,
+  CTRL_PERF_DATA_STALLS = 0x003,
+  CTRL_PERF_ALU_READS = 0x004,
+  CTRL_ALU_BUSY = 0x010,
+  CTRL_LOOP_START = 0x020,
+  CTRL_LOOP_END = 0x021,
+  CTRL_LOOP_COUNT = 0x022,
+  CTRL_IRQ_ENABLE = 0x030,
+  CTRL_IRQ_PENDING = 0x031,
+  CTRL_IRQ_VECTOR = 0x032,
+  CTRL_IRQ_EPC = 0x033,
+  CTRL_IRQ_RETURN = 0x034,
+};
+
+// Interrupt lines, as bits of CTRL_IRQ_ENABLE and CTRL_IRQ_PENDING, see
+// rtl/common.vh.
+enum class IrqSource {
+  IRQ_UART_RX = 0,
+  IRQ_UART_TX_EMPTY = 1,
+};
+
+// Data bus word addresses from here up go to devices rather than memory, as
+// IO_BASE in rtl/common.vh.
+constexpr uint32_t kIoBase = 0x3fffff00;
+
+// Data bus word addresses of the UART's registers, see rtl/common.vh.
+enum class UartReg : uint32_t {
+  UART_DATA = 0x3fffff00,
+  UART_STATUS = 0x3fffff01,
+};
+
+// simtop's console, see ConsoleSim.
+enum class ConsoleReg : uint32_t {
+  CONSOLE_DATA = 0x3fffff02,
 };
 
 class Instr;
 using Program = std::vector<Instr>;
 class Instr {
  public:
+  // Bit layout of an instruction word, as decoded by rtl/decoder.sv.
+  struct OpFormat {
+    unsigned short src_unit : 4;
+    unsigned short si : 12;
+    unsigned dst_unit : 4;
+    unsigned short di : 12;
+  };
+  static OpFormat Decode(uint32_t op);
+
+  // Bit layouts of the header words ahead of an instruction, as decoded by
+  // rtl/decoder.sv. A pair carries a move in a narrower form than OpFormat.
+  struct PairFormat {
+    unsigned bundle : 4;  // UNIT_BUNDLE
+    unsigned src_unit : 4;
+    unsigned si : 8;
+    unsigned dst_unit : 4;
+    unsigned di : 8;
+    unsigned kind : 4;  // HEADER_PAIR
+  };
+  struct GuardFormat {
+    unsigned bundle : 4;  // UNIT_BUNDLE
+    unsigned unit : 4;    // UNIT_REGISTER or UNIT_ALU_RESULT
+    unsigned index : 8;
+    unsigned invert : 1;
+    unsigned : 11;
+    unsigned kind : 4;  // HEADER_GUARD
+  };
+  static bool IsHeader(uint32_t op) {
+    return (op & 0xf) == (unsigned)Unit::UNIT_BUNDLE;
+  }
+  static HeaderKind KindOf(uint32_t header) {
+    return (HeaderKind)(header >> 28);
+  }
+  static PairFormat DecodePair(uint32_t header);
+  static GuardFormat DecodeGuard(uint32_t header);
+
+  // Whether a move can be bundled with another, see Pair().
+  static bool CanPair(const OpFormat& op);
+
+  // Reconstruct the instruction (and its operands) starting at code.
+  static Instr Disassemble(const uint32_t* code);
+
+  // Encodings of a move and of the header words, for constant expressions
+  // such as a fixed program built as a constexpr array. Immediates are cut
+  // to the width of their fields.
+  static constexpr uint32_t Encode(Unit src, unsigned si, Unit dst,
+                                   unsigned di) {
+    return ((unsigned)src & 0xfU) | (si & 0xfffU) << 4U |
+           ((unsigned)dst & 0xfU) << 16U | (di & 0xfffU) << 20U;
+  }
+  static constexpr uint32_t EncodePair(Unit src, unsigned si, Unit dst,
+                                       unsigned di) {
+    return (unsigned)Unit::UNIT_BUNDLE | ((unsigned)src & 0xfU) << 4U |
+           (si & 0xffU) << 8U | ((unsigned)dst & 0xfU) << 16U |
+           (di & 0xffU) << 20U | (unsigned)HeaderKind::HEADER_PAIR << 28U;
+  }
+  static constexpr uint32_t EncodeGuard(Unit u, unsigned r, bool invert) {
+    return (unsigned)Unit::UNIT_BUNDLE | ((unsigned)u & 0xfU) << 4U |
+           (r & 0xffU) << 8U | (unsigned)invert << 16U |
+           (unsigned)HeaderKind::HEADER_GUARD << 28U;
+  }
+
   std::vector<uint32_t> assemble() const;
+  // The same words, written to out, which has room for size() of them.
+  // Returns how many were written.
+  size_t AssembleTo(uint32_t* out) const;
+
+  // Number of words assemble() produces.
+  size_t size() const;
+
+  // Assemble a whole program into the n words at out, say a simulated
+  // memory, without allocating. Returns how many words were written, Size()
+  // of them; the program has to fit.
+  static size_t Assemble(const Program& program, uint32_t* out, size_t n);
+  static size_t Size(const Program& program);
+
+  // Human readable form, e.g. "R01 := *(07b)", with a bundled move after
+  // " || " and any guard in front, e.g. "(!R02) PC := #010".
+  std::string ToString() const;
 
   bool UsesSoperand() const;
   bool UsesDoperand() const;
@@ -56,18 +203,53 @@ class Instr {
   Instr& Si(short i);
   Instr& Di(short i);
 
+  // Set the access width of a memory operand or register pointer source or
+  // destination, in the upper bits of its immediate. Call after Si()/Di().
+  Instr& SrcWidth(MemWidth w);
+  Instr& DstWidth(MemWidth w);
+
+  // Set how a register pointer source or destination updates its register.
+  // Call after Si()/Di().
+  Instr& SrcPtr(PtrMode m);
+  Instr& DstPtr(PtrMode m);
+
   Instr& Soperand(uint32_t o);
 
   Instr& Doperand(uint32_t o);
 
+  // Stack shorthands. Push() and Pop() move to and from the top of the
+  // stack; Poke(n) and Peek(n) write and read the entry n below the top
+  // without moving it.
+  Instr& Push();
+  Instr& Pop();
+  Instr& Poke(short n);
+  Instr& Peek(short n);
+
+  // Bundle other with this instruction, to be made in the same cycle. It's
+  // encoded in a header word ahead of this one, which limits it to 8 bit
+  // immediates and the units execute can handle alongside any other move:
+  // register, ALU left/right or immediate sources, and register or ALU
+  // destinations, see rtl/common.vh. Both moves read their sources before
+  // either writes, and other's write wins should they go to the same place.
+  Instr& Pair(const Instr& other);
+
+  // Guard the instruction on register r, or ALU r's result, for u
+  // UNIT_REGISTER or UNIT_ALU_RESULT: If() squashes it when the value is
+  // zero, and IfNot() when it isn't. A squashed instruction, and any move
+  // bundled with it, has no effect. Also encoded in a header word.
+  Instr& If(Unit u, short r);
+  Instr& IfNot(Unit u, short r);
+
+  const OpFormat& op() const { return op_; }
+  const std::optional<OpFormat>& paired() const { return paired_; }
+  const std::optional<GuardFormat>& guard() const { return guard_; }
+  const std::optional<uint32_t>& soperand() const { return soperand_; }
+  const std::optional<uint32_t>& doperand() const { return doperand_; }
+
  private:
-  struct OpFormat {
-    unsigned short src_unit : 4;
-    unsigned short si : 12;
-    unsigned dst_unit : 4;
-    unsigned short di : 12;
-  };
   OpFormat op_;
+  std::optional<OpFormat> paired_;
+  std::optional<GuardFormat> guard_;
   std::optional<uint32_t> soperand_;
   std::optional<uint32_t> doperand_;
 };
@@ -0,0 +1,58 @@
+#include "batch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace {
+
+BatchResult RunOne(const Program& program,
+                   size_t index,
+                   const BatchOptions& options) {
+  TestBench tb;
+  tb.Reset();
+  if (options.lockstep)
+    tb.EnableLockstep();
+  tb.Load(program);
+  if (options.setup)
+    options.setup(tb, index);
+
+  const int start = tb.clk().cycles();
+  BatchResult result;
+  result.retired = tb.RunInstructions(
+      options.instructions ? options.instructions : program.size(),
+      options.max_clocks);
+  // Let the last register write land, as lockstep does.
+  tb.Step();
+  result.clocks = tb.clk().cycles() - start;
+  result.divergence = tb.divergence();
+  result.pc = tb.top()->pc_o;
+  for (int r = 0; r < Emulator::kNumRegisters; r++)
+    result.regs.push_back(tb.top()->regs_o[r]);
+  result.ram.assign(tb.ram()->mem().begin(), tb.ram()->mem().end());
+  return result;
+}
+
+}  // namespace
+
+std::vector<BatchResult> RunBatch(const std::vector<Program>& programs,
+                                  const BatchOptions& options) {
+  std::vector<BatchResult> results(programs.size());
+  int threads = options.threads;
+  if (threads <= 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = std::min<size_t>(threads, programs.size());
+
+  std::atomic<size_t> next(0);
+  auto work = [&] {
+    for (size_t i = next++; i < programs.size(); i = next++)
+      results[i] = RunOne(programs[i], i, options);
+  };
+  std::vector<std::thread> workers;
+  for (int t = 1; t < threads; t++)
+    workers.emplace_back(work);
+  work();
+  for (auto& worker : workers)
+    worker.join();
+  return results;
+}
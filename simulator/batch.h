@@ -0,0 +1,46 @@
+#pragma once
+
+#include <verilated.h>
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "assembler.h"
+#include "testbench.h"
+
+// Runs programs on TestBenches spread across threads, for the thousands of
+// generated programs a single TestBench would take too long over. Each
+// program gets a fresh TestBench, with its own model, memories and trace,
+// so they're independent of one another and of the order they run in.
+struct BatchOptions {
+  // Run each program until this many instructions have retired, or if 0,
+  // as many as are in it, or until max_clocks have gone by.
+  int instructions = 0;
+  int max_clocks = 100000;
+  // Check each program against the emulator, see TestBench::EnableLockstep.
+  bool lockstep = true;
+  // Worker threads; 0 has one per hardware thread. Models verilated
+  // multi-threaded (TTA_VERILATOR_THREADS) want fewer.
+  int threads = 0;
+  // Called with each TestBench and the index of its program after loading
+  // it, e.g. to fill data memory. Runs on the worker threads.
+  std::function<void(TestBench&, size_t)> setup;
+};
+
+// What a program left behind.
+struct BatchResult {
+  int retired = 0;
+  int clocks = 0;
+  // The first difference from the emulator, with lockstep.
+  std::optional<std::string> divergence;
+  uint32_t pc = 0;
+  std::vector<IData> regs;
+  std::vector<IData> ram;
+};
+
+// Results come back in the same order as programs.
+std::vector<BatchResult> RunBatch(const std::vector<Program>& programs,
+                                  const BatchOptions& options = {});
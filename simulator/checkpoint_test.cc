@@ -0,0 +1,178 @@
+// Save() and Restore() of each of the simulator's models: restored into a
+// fresh object, the state must save the same again, and carry on the same.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "clock_gen.h"
+#include "console_sim.h"
+#include "memory_image.h"
+#include "uart_sim.h"
+
+namespace {
+
+// A checkpoint in memory, in place of VerilatedSave and VerilatedRestore.
+class Checkpoint {
+ public:
+  void write(const void* p, size_t n) {
+    bytes_.append(static_cast<const char*>(p), n);
+  }
+  void read(void* p, size_t n) {
+    ASSERT_LE(at_ + n, bytes_.size()) << "Read past the end";
+    memcpy(p, bytes_.data() + at_, n);
+    at_ += n;
+  }
+
+  const std::string& bytes() const { return bytes_; }
+  bool all_read() const { return at_ == bytes_.size(); }
+
+ private:
+  std::string bytes_;
+  size_t at_ = 0;
+};
+
+template <typename T>
+std::string Saved(const T& t) {
+  Checkpoint c;
+  t.Save(c);
+  return c.bytes();
+}
+
+// Restores a copy of from's state into to.
+template <typename T>
+void Copy(const T& from, T* to) {
+  Checkpoint c;
+  from.Save(c);
+  to->Restore(c);
+  EXPECT_TRUE(c.all_read());
+  EXPECT_EQ(Saved(*to), c.bytes());
+}
+
+}  // namespace
+
+TEST(CheckpointTest, MemoryImage) {
+  constexpr size_t kPage = 1024;
+  MemoryImage mem(8 * kPage);
+  mem[1] = 1;
+  mem[2 * kPage + 5] = 2;
+  mem.RandomizeOnTouch(7);
+  const IData garbage = mem[4 * kPage];
+
+  MemoryImage restored(8 * kPage);
+  restored[6 * kPage] = 3;  // Gone once restored
+  Copy(mem, &restored);
+  EXPECT_TRUE(std::equal(mem.begin(), mem.end(), restored.begin()));
+  EXPECT_EQ(restored.data()[6 * kPage], 0);
+  // Pages already touched stay as they were, and the rest are still to be
+  // randomized.
+  EXPECT_EQ(restored[1], 1);
+  EXPECT_EQ(restored[2 * kPage + 6], 0);
+  EXPECT_EQ(restored[4 * kPage], garbage);
+  int nonzero = 0;
+  for (size_t i = 0; i < kPage; i++)
+    nonzero += restored[7 * kPage + i] != 0;
+  EXPECT_GT(nonzero, 0);
+
+  MemoryImage other(4 * kPage);
+  Checkpoint c;
+  mem.Save(c);
+  EXPECT_DEATH(other.Restore(c), "different size");
+}
+
+// Part way through receiving a byte and sending two, the restored UART
+// finishes both the same.
+TEST(CheckpointTest, UARTSim) {
+  constexpr int kClocksPerBit = 4;
+  std::ostringstream out, restored_out;
+  UARTSim uart(out, kClocksPerBit), restored(restored_out, kClocksPerBit);
+  uart.Send("hi");
+  // 'A' on txd: start bit, data from the bottom, stop bit.
+  std::vector<bool> txd;
+  const unsigned frame = 0x200 | ('A' << 1);
+  for (int bit = 0; bit < 10; bit++)
+    txd.insert(txd.end(), kClocksPerBit, (frame >> bit) & 1);
+  txd.insert(txd.end(), 2 * 10 * kClocksPerBit, true);
+
+  CData rxd = 1, restored_rxd = 1;
+  const size_t kHalfway = 5 * kClocksPerBit + 1;
+  for (size_t i = 0; i < kHalfway; i++)
+    uart.Clock(txd[i], &rxd);
+  Copy(uart, &restored);
+  restored_rxd = rxd;
+  for (size_t i = kHalfway; i < txd.size(); i++) {
+    uart.Clock(txd[i], &rxd);
+    restored.Clock(txd[i], &restored_rxd);
+    ASSERT_EQ(restored_rxd, rxd) << "Clock " << i;
+  }
+  EXPECT_EQ(out.str(), "A");
+  EXPECT_EQ(restored_out.str(), "A");
+  EXPECT_FALSE(restored.sending());
+}
+
+// The restored clock gives the same edges, on the same steps, and releases
+// reset at the same time.
+TEST(CheckpointTest, ClockGenerator) {
+  constexpr int kDivisor = 3;
+  CData reset = 1, clk = 0;
+  ClockGenerator clock(kDivisor, 2 /* reset_cycles */, &reset, &clk);
+  for (int i = 0; i < 4; i++)
+    clock.Step();
+  ASSERT_EQ(reset, 1);
+
+  // The pins are the model's, so copied along with it.
+  CData restored_reset = reset, restored_clk = clk;
+  ClockGenerator restored(kDivisor, 2, &restored_reset, &restored_clk);
+  Copy(clock, &restored);
+  for (int i = 0; i < 8 * kDivisor; i++) {
+    if (i % 2) {
+      clock.Step();
+      restored.Step();
+    } else {
+      clock.Edge();
+      restored.Edge();
+    }
+    ASSERT_EQ(restored.Bus(), clock.Bus()) << "Step " << clock.step();
+    ASSERT_EQ(restored.step(), clock.step());
+    ASSERT_EQ(restored.cycles(), clock.cycles());
+    ASSERT_EQ(restored_clk, clk) << "Step " << clock.step();
+    ASSERT_EQ(restored_reset, reset) << "Step " << clock.step();
+  }
+  EXPECT_EQ(reset, 0);
+}
+
+// Mid-wait, and mid-drain, the restored console takes the same batches.
+TEST(CheckpointTest, ConsoleSim) {
+  constexpr int kDepth = 8;
+  std::ostringstream out, restored_out;
+  ConsoleSim console(out, kDepth, 4 /* drain_interval */);
+  ConsoleSim restored(restored_out, kDepth, 4);
+  WData data[2] = {'a' | 'b' << 8, 0};
+  CData drain = 0;
+  console.Clock(data, 2, &drain);
+  console.Clock(data, 2, &drain);
+  Copy(console, &restored);
+  CData restored_drain = drain;
+  for (int i = 0; i < 2; i++) {
+    console.Clock(data, 2, &drain);
+    restored.Clock(data, 2, &restored_drain);
+    EXPECT_EQ(restored_drain, drain);
+  }
+  EXPECT_EQ(out.str(), "ab");
+  EXPECT_EQ(restored_out.str(), "ab");
+  ASSERT_TRUE(drain);
+
+  // Draining, it mustn't take the same bytes twice.
+  std::ostringstream drained_out;
+  ConsoleSim drained(drained_out, kDepth, 4);
+  Copy(console, &drained);
+  drained.Flush(data, 2);
+  EXPECT_EQ(drained_out.str(), "");
+  CData drained_drain = drain;
+  drained.Clock(data, 2, &drained_drain);
+  EXPECT_FALSE(drained_drain);
+}
@@ -22,7 +22,17 @@ void ClockGenerator::Step(VerilatedFstC* trace) {
 
   if (trace) {
     trace->dump(step_);
-    trace->flush();
+    if (trace_flush_interval_ > 0 &&
+        step_ - last_flush_ >= trace_flush_interval_) {
+      trace->flush();
+      last_flush_ = step_;
+    }
   }
   step_++;
 }
+
+void ClockGenerator::Edge(VerilatedFstC* trace) {
+  if (step_ % divisor_ != 0)
+    step_ += divisor_ - step_ % divisor_;
+  Step(trace);
+}
@@ -2,7 +2,7 @@
 
 #include <verilated.h>
 
-class VerilatedVcdC;
+class VerilatedFstC;
 
 class ClockGenerator {
  public:
@@ -19,10 +19,39 @@ class ClockGenerator {
 
   void Step(VerilatedFstC* trace = nullptr);
 
+  // Skip ahead to the next step the clock toggles on, and take it. The
+  // divisor - 1 steps in between change nothing, so a caller evaluating the
+  // model after each call saves that many evaluations per clock edge. The
+  // trace only has the clock edges, at the same times as Step() gives them.
+  void Edge(VerilatedFstC* trace = nullptr);
+
+  // How often, in steps, Step() flushes the trace it dumps to: at the first
+  // dump at least that many steps after the last flush, so steps Edge()
+  // skips count too. 1 flushes on every step, which is slow but means a
+  // crash never loses trace data. 0 leaves flushing to the trace writer
+  // itself (and to close()).
+  void set_trace_flush_interval(int steps) { trace_flush_interval_ = steps; }
+
   bool Bus() const { return posedge_bus_; }
   const int step() const { return step_; }
   const int cycles() const { return cycle_; }
 
+  // Checkpoint the counters, as MemoryImage::Save() and Restore(). The
+  // reset and clock pins are the model's to save.
+  template <typename Out>
+  void Save(Out& out) const {
+    out.write(&posedge_bus_, sizeof(posedge_bus_));
+    out.write(&step_, sizeof(step_));
+    out.write(&cycle_, sizeof(cycle_));
+  }
+  template <typename In>
+  void Restore(In& in) {
+    in.read(&posedge_bus_, sizeof(posedge_bus_));
+    in.read(&step_, sizeof(step_));
+    in.read(&cycle_, sizeof(cycle_));
+    last_flush_ = step_;
+  }
+
  private:
   const int divisor_;
   const int reset_steps_;
@@ -30,6 +59,10 @@ class ClockGenerator {
   CData* reset_;
   CData* clk_bus_;
 
+  int trace_flush_interval_ = 1;
+  // The step the trace was last flushed at.
+  int last_flush_ = -1;
+
   bool posedge_bus_ = false;
   int step_ = 0;
   int cycle_ = 0;
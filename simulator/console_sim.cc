@@ -0,0 +1,31 @@
+#include "console_sim.h"
+
+#include <string>
+
+void ConsoleSim::Clock(const WData* data, unsigned count, CData* drain) {
+  if (draining_) {
+    // That clock emptied it, keeping anything written at the same time.
+    draining_ = false;
+    *drain = 0;
+  } else if (count == 0) {
+    wait_ = drain_interval_;
+  } else if ((int)count >= depth_ || --wait_ <= 0) {
+    Take(data, count);
+    draining_ = true;
+    *drain = 1;
+  }
+}
+
+void ConsoleSim::Flush(const WData* data, unsigned count) {
+  if (!draining_ && count != 0)
+    Take(data, count);
+}
+
+void ConsoleSim::Take(const WData* data, unsigned count) {
+  std::string bytes(count, 0);
+  for (unsigned i = 0; i < count; i++)
+    bytes[i] = data[i / 4] >> (8 * (i % 4));
+  out_ << bytes;
+  out_.flush();
+  wait_ = drain_interval_;
+}
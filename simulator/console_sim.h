@@ -0,0 +1,56 @@
+#pragma once
+
+#include <verilated.h>
+
+#include <ostream>
+
+// The simulator's end of simtop's console (rtl/console.sv). Bytes the design
+// writes there are taken a batch at a time, once the buffer fills or they've
+// waited drain_interval bus clocks, and written to out_stream, which is
+// flushed after each batch rather than each byte.
+class ConsoleSim {
+ public:
+  // Bytes in the buffer, as simtop's console is built with.
+  static constexpr int kDepth = 64;
+  static constexpr int kDrainInterval = 4096;
+
+  explicit ConsoleSim(std::ostream& out_stream,
+                      int depth = kDepth,
+                      int drain_interval = kDrainInterval)
+      : out_(out_stream),
+        depth_(depth),
+        drain_interval_(drain_interval),
+        wait_(drain_interval) {}
+
+  // Advances a bus clock, given the console's data_o and count_o. Drives
+  // drain_i, for a clock after taking a batch.
+  void Clock(const WData* data, unsigned count, CData* drain);
+
+  // Take whatever is left in the buffer, at the end of a run.
+  void Flush(const WData* data, unsigned count);
+
+  // Checkpoint the state between batches, as MemoryImage::Save() and
+  // Restore(). Output already written stays written.
+  template <typename Out>
+  void Save(Out& out) const {
+    out.write(&wait_, sizeof(wait_));
+    out.write(&draining_, sizeof(draining_));
+  }
+  template <typename In>
+  void Restore(In& in) {
+    in.read(&wait_, sizeof(wait_));
+    in.read(&draining_, sizeof(draining_));
+  }
+
+ private:
+  void Take(const WData* data, unsigned count);
+
+  std::ostream& out_;
+  const int depth_;
+  const int drain_interval_;
+  // Clocks the oldest byte waiting may still wait.
+  int wait_;
+  // Whether the buffer is being emptied at this clock, its bytes having
+  // been taken already.
+  bool draining_ = false;
+};
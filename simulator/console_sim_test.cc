@@ -0,0 +1,48 @@
+#include "console_sim.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+// Plays the part of simtop's console: each clock, empties it if drain was
+// set, then queues the bytes written.
+TEST(ConsoleSimTest, Batches) {
+  std::ostringstream out;
+  ConsoleSim console(out, 8, 4 /* drain_interval */);
+  WData data[2] = {};
+  unsigned count = 0;
+  CData drain = 0;
+  auto clock = [&](const std::string& written) {
+    if (drain)
+      count = 0;
+    for (char c : written) {
+      data[count / 4] &= ~(0xffU << (8 * (count % 4)));
+      data[count / 4] |= (unsigned char)c << (8 * (count % 4));
+      count++;
+    }
+    console.Clock(data, count, &drain);
+  };
+
+  // Held until they've waited drain_interval clocks,
+  clock("ab");
+  clock("");
+  clock("");
+  EXPECT_EQ(out.str(), "");
+  clock("");
+  EXPECT_EQ(out.str(), "ab");
+  EXPECT_TRUE(drain);
+  // keeping what's written while it drains,
+  clock("c");
+  EXPECT_FALSE(drain);
+  // or until the buffer fills.
+  clock("defghij");
+  EXPECT_EQ(out.str(), "abcdefghij");
+  EXPECT_TRUE(drain);
+  // What's left at the end, but not what's already been taken.
+  console.Flush(data, count);
+  EXPECT_EQ(out.str(), "abcdefghij");
+  clock("k");
+  console.Flush(data, count);
+  EXPECT_EQ(out.str(), "abcdefghijk");
+}
@@ -0,0 +1,542 @@
+#include "emulator.h"
+
+#include <glog/logging.h>
+
+#include <array>
+
+namespace {
+
+constexpr bool HasOperand(Unit u) {
+  return u == Unit::UNIT_MEMORY_OPERAND || u == Unit::UNIT_ABS_OPERAND;
+}
+
+// Clock costs of the sequencer and execute state machines. Approximate: bus
+// latency is assumed to be a single cycle, as it is against RAMSim.
+constexpr int kFetchDecodeCycles = 3;  // SEQ_START, SEQ_READ_OPCODE, SEQ_DECODE
+constexpr int kOperandCycles = 1;      // SEQ_READ_*_OPERAND
+constexpr int kSecondOperandCycles = 2;  // + SEQ_READ_DST_OPERAND_START
+constexpr int kSrcCycles = 1;            // EXEC_START_SRC
+constexpr int kSrcRetrieveCycles = 1;  // EXEC_SRC_MEM_RETRIEVE
+constexpr int kDstCycles = 1;          // EXEC_START_DST
+constexpr int kDstStoreCycles = 1;     // EXEC_DST_MEM_STORE
+// A bundle header's SEQ_START, SEQ_READ_OPCODE and SEQ_DECODE, less the
+// SEQ_START of the instruction it goes with, which its SEQ_DECODE does.
+constexpr int kHeaderCycles = 2;
+
+// Clocks after its inputs are written before an ALU has the result, from
+// alu_unit.sv. Reads of UNIT_ALU_RESULT wait in EXEC_SRC_ALU_RETRIEVE until
+// then.
+constexpr int kMulCycles = 8;
+constexpr int kDivCycles = 32;
+
+constexpr int AluLatency(ALUOp op) {
+  switch (op) {
+    case ALUOp::ALU_MUL:
+      return kMulCycles;
+    case ALUOp::ALU_DIV:
+    case ALUOp::ALU_MOD:
+      return kDivCycles;
+    default:
+      return 0;
+  }
+}
+
+// Clocks from the start of an instruction to EXEC_START_SRC.
+constexpr int IssueCycles(Unit src, Unit dst) {
+  int cycles = kFetchDecodeCycles;
+  if (HasOperand(src) && HasOperand(dst))
+    cycles += kOperandCycles + kSecondOperandCycles;
+  else if (HasOperand(src) || HasOperand(dst))
+    cycles += kOperandCycles;
+  return cycles;
+}
+
+constexpr bool IsMemory(Unit u) {
+  return u == Unit::UNIT_MEMORY_IMMEDIATE || u == Unit::UNIT_MEMORY_OPERAND ||
+         u == Unit::UNIT_REGISTER_POINTER;
+}
+
+// Unstalled; an ALU still working adds to this.
+constexpr int CyclesFor(Unit src, Unit dst) {
+  int cycles = IssueCycles(src, dst) + kSrcCycles;
+
+  // Sources which are available straight away write non-memory
+  // destinations in EXEC_START_SRC.
+  const bool retrieve = IsMemory(src);
+  if (retrieve)
+    cycles += kSrcRetrieveCycles;
+  if (retrieve || IsMemory(dst))
+    cycles += kDstCycles;
+  if (IsMemory(dst))
+    cycles += kDstStoreCycles;
+  return cycles;
+}
+
+// Width of a memory operand or register pointer access.
+constexpr MemWidth WidthOf(Unit u, unsigned short immediate) {
+  if (u == Unit::UNIT_MEMORY_OPERAND || u == Unit::UNIT_REGISTER_POINTER)
+    return (MemWidth)(immediate >> 8);
+  return MemWidth::MEM_WORD;
+}
+
+using CycleTable = std::array<std::array<uint8_t, 16>, 16>;
+constexpr CycleTable BuildCycleTable() {
+  CycleTable table = {};
+  for (int src = 0; src < 16; src++)
+    for (int dst = 0; dst < 16; dst++)
+      table[src][dst] = CyclesFor((Unit)src, (Unit)dst);
+  return table;
+}
+constexpr CycleTable kCycles = BuildCycleTable();
+
+}  // namespace
+
+Emulator::Emulator(std::vector<IData>& program, std::vector<IData>& data)
+    : Emulator(program.data(), program.size(), data.data(), data.size()) {}
+
+Emulator::Emulator(IData* program,
+                   size_t program_size,
+                   IData* data,
+                   size_t data_size)
+    : program_(program),
+      data_(data),
+      program_mask_(program_size - 1),
+      data_mask_(data_size - 1) {
+  CHECK_EQ(program_size & program_mask_, 0u) << "Program size not power of 2";
+  CHECK_EQ(data_size & data_mask_, 0u) << "Data size not power of 2";
+}
+
+void Emulator::Reset() {
+  state_ = State();
+  last_store_.reset();
+  read_device_ = false;
+  instructions_ = 0;
+  cycles_ = 0;
+}
+
+IData Emulator::ALU(ALUOp op, IData a, IData b) {
+  // Mirrors alu_unit.sv. Operands are unsigned there, which makes ALU_SRA a
+  // logical shift; AND and OR are logical rather than bitwise; XOR reduces
+  // the left operand. Verilator's divide by zero gives zero.
+  switch (op) {
+    case ALUOp::ALU_NOP:
+      return 0;
+    case ALUOp::ALU_ADD:
+      return a + b;
+    case ALUOp::ALU_SUB:
+      return a - b;
+    case ALUOp::ALU_MUL:
+      return a * b;
+    case ALUOp::ALU_DIV:
+      return b ? a / b : 0;
+    case ALUOp::ALU_MOD:
+      return b ? a % b : 0;
+    case ALUOp::ALU_EQL:
+      return a == b;
+    case ALUOp::ALU_SL:
+      return b < 32 ? a << b : 0;
+    case ALUOp::ALU_SR:
+    case ALUOp::ALU_SRA:
+      return b < 32 ? a >> b : 0;
+    case ALUOp::ALU_NOT:
+      return ~a;
+    case ALUOp::ALU_AND:
+      return a && b;
+    case ALUOp::ALU_OR:
+      return a || b;
+    case ALUOp::ALU_XOR:
+      return __builtin_parity(a);
+    case ALUOp::ALU_GT:
+      return a > b;
+    case ALUOp::ALU_LT:
+      return a < b;
+  }
+  return 0;
+}
+
+// Width codes beyond MEM_HALF_SIGNED take a byte address, as every code but
+// MEM_WORD does, and move the whole word it's in, as execute.sv's defaults
+// do.
+IData Emulator::LoadAs(MemWidth w, IData addr) {
+  if ((w == MemWidth::MEM_WORD ? addr : addr >> 2) >= kIoBase) {
+    read_device_ = true;
+    return 0;
+  }
+  if (w == MemWidth::MEM_WORD)
+    return Data(addr);
+  const IData word = Data(addr >> 2);
+  const uint8_t b = word >> (addr % 4 * 8);
+  const uint16_t h = word >> (addr & 2 ? 16 : 0);
+  switch (w) {
+    case MemWidth::MEM_BYTE:
+      return b;
+    case MemWidth::MEM_BYTE_SIGNED:
+      return (IData)(int8_t)b;
+    case MemWidth::MEM_HALF:
+      return h;
+    case MemWidth::MEM_HALF_SIGNED:
+      return (IData)(int16_t)h;
+    default:
+      return word;
+  }
+}
+
+void Emulator::StoreAs(MemWidth w, IData addr, IData data) {
+  IData mask;
+  switch (w) {
+    case MemWidth::MEM_WORD:
+      Write(addr, data);
+      return;
+    case MemWidth::MEM_BYTE:
+    case MemWidth::MEM_BYTE_SIGNED:
+      mask = 0xffu << (addr % 4 * 8);
+      data = (data & 0xff) * 0x01010101u;
+      break;
+    case MemWidth::MEM_HALF:
+    case MemWidth::MEM_HALF_SIGNED:
+      mask = addr & 2 ? 0xffff0000u : 0x0000ffffu;
+      data = (data & 0xffff) * 0x00010001u;
+      break;
+    default:
+      mask = 0xffffffffu;
+      break;
+  }
+  const IData word_addr = addr >> 2;
+  Write(word_addr, (Data(word_addr) & ~mask) | (data & mask));
+}
+
+IData Emulator::PointerAccess(unsigned short immediate) {
+  const MemWidth w = (MemWidth)(immediate >> 8);
+  const IData step =
+      w == MemWidth::MEM_HALF || w == MemWidth::MEM_HALF_SIGNED ? 2 : 1;
+  IData& r = state_.regs[immediate % kNumRegisters];
+  switch ((PtrMode)(immediate >> 6 & 3)) {
+    case PtrMode::PTR_POST_INC: {
+      const IData addr = r;
+      r += step;
+      return addr;
+    }
+    case PtrMode::PTR_PRE_DEC:
+      return r -= step;
+    default:
+      return r;
+  }
+}
+
+int Emulator::Cycles(const Instr::OpFormat& op) {
+  return kCycles[op.src_unit][op.dst_unit];
+}
+
+int Emulator::Cycles(const Instr& instr) {
+  const int headers = instr.guard().has_value() + instr.paired().has_value();
+  return Cycles(instr.op()) + headers * kHeaderCycles;
+}
+
+int Emulator::AluCycles(ALUOp op) {
+  return AluLatency(op);
+}
+
+IData Emulator::PairedSource(const Instr::PairFormat& h) const {
+  switch ((Unit)h.src_unit) {
+    case Unit::UNIT_REGISTER:
+      return state_.regs[h.si % kNumRegisters];
+    case Unit::UNIT_ALU_LEFT:
+      return state_.alu_left[h.si % kNumALUs];
+    case Unit::UNIT_ALU_RIGHT:
+      return state_.alu_right[h.si % kNumALUs];
+    case Unit::UNIT_ABS_IMMEDIATE:
+      return h.si;
+    default:
+      return 0;
+  }
+}
+
+void Emulator::WritePaired(const Instr::PairFormat& h, IData v) {
+  switch ((Unit)h.dst_unit) {
+    case Unit::UNIT_REGISTER:
+      state_.regs[h.di % kNumRegisters] = v;
+      break;
+    case Unit::UNIT_ALU_LEFT:
+      state_.alu_left[h.di % kNumALUs] = v;
+      break;
+    case Unit::UNIT_ALU_RIGHT:
+      state_.alu_right[h.di % kNumALUs] = v;
+      break;
+    case Unit::UNIT_ALU_OPERATOR:
+      state_.alu_op[h.di % kNumALUs] = (ALUOp)(v & 0xf);
+      break;
+    default:
+      break;
+  }
+}
+
+void Emulator::CountRetired(Unit src, Unit dst, int cycles) {
+  IData* perf = state_.perf;
+  perf[(int)ControlReg::CTRL_PERF_CYCLES] += cycles;
+  perf[(int)ControlReg::CTRL_PERF_INSTRET]++;
+  perf[(int)ControlReg::CTRL_PERF_OPERAND_FETCHES] +=
+      HasOperand(src) + HasOperand(dst);
+  if (src == Unit::UNIT_ALU_RESULT)
+    perf[(int)ControlReg::CTRL_PERF_ALU_READS]++;
+}
+
+void Emulator::Step() {
+  read_device_ = false;
+  // Taken in SEQ_START, which the handler's fetch follows without a pause.
+  if (!state_.irq_active && (state_.irq_lines & state_.irq_enable)) {
+    state_.irq_epc = state_.pc;
+    state_.pc = state_.irq_vector;
+    state_.irq_active = true;
+  }
+
+  // Headers, of which the decoder keeps the last of each kind.
+  uint32_t word = Fetch();
+  std::optional<Instr::PairFormat> pair;
+  std::optional<Instr::GuardFormat> guard;
+  int header_cycles = 0;
+  while (Instr::IsHeader(word)) {
+    switch (Instr::KindOf(word)) {
+      case HeaderKind::HEADER_PAIR:
+        pair = Instr::DecodePair(word);
+        break;
+      case HeaderKind::HEADER_GUARD:
+        guard = Instr::DecodeGuard(word);
+        break;
+    }
+    header_cycles += kHeaderCycles;
+    word = Fetch();
+  }
+  const Instr::OpFormat op = Instr::Decode(word);
+  const Unit src = (Unit)op.src_unit;
+  const Unit dst = (Unit)op.dst_unit;
+  const IData soperand = HasOperand(src) ? Fetch() : 0;
+  const IData doperand = HasOperand(dst) ? Fetch() : 0;
+
+  // The sequencer goes round the loop as it finishes fetching, before the
+  // instruction runs.
+  if (dst != Unit::UNIT_PC && state_.loop_count &&
+      state_.pc == state_.loop_end) {
+    if (--state_.loop_count)
+      state_.pc = state_.loop_start;
+  }
+
+  // When the source is read, for ALUs which haven't finished yet.
+  uint64_t read_cycle = cycles_ + header_cycles + IssueCycles(src, dst);
+  int stall_cycles = 0;
+
+  if (guard) {
+    // The instruction waits for a guarding ALU before it starts.
+    IData g;
+    if ((Unit)guard->unit == Unit::UNIT_REGISTER) {
+      g = state_.regs[guard->index % kNumRegisters];
+    } else {
+      const int alu = guard->index % kNumALUs;
+      g = ALU(state_.alu_op[alu], state_.alu_left[alu], state_.alu_right[alu]);
+      if (state_.alu_ready[alu] > read_cycle) {
+        stall_cycles = state_.alu_ready[alu] - read_cycle;
+        read_cycle = state_.alu_ready[alu];
+      }
+    }
+    if ((g == 0) != (bool)guard->invert) {
+      // Squashed, in EXEC_START_SRC.
+      last_store_.reset();
+      const int cycles = header_cycles + IssueCycles(src, dst) + kSrcCycles +
+                         stall_cycles;
+      CountRetired(src, dst, cycles);
+      instructions_++;
+      cycles_ += cycles;
+      return;
+    }
+  }
+
+  // Read before the instruction changes anything.
+  const IData paired_value = pair ? PairedSource(*pair) : 0;
+
+  IData v = state_.src_value;
+  switch (src) {
+    case Unit::UNIT_NONE:
+      v = 0;
+      break;
+    case Unit::UNIT_REGISTER:
+      v = state_.regs[op.si % kNumRegisters];
+      break;
+    case Unit::UNIT_ALU_LEFT:
+      v = state_.alu_left[op.si % kNumALUs];
+      break;
+    case Unit::UNIT_ALU_RIGHT:
+      v = state_.alu_right[op.si % kNumALUs];
+      break;
+    case Unit::UNIT_ALU_RESULT: {
+      const int alu = op.si % kNumALUs;
+      v = ALU(state_.alu_op[alu], state_.alu_left[alu], state_.alu_right[alu]);
+      if (state_.alu_ready[alu] > read_cycle) {
+        // Waits in EXEC_SRC_ALU_RETRIEVE, and then needs EXEC_START_DST.
+        stall_cycles += state_.alu_ready[alu] - read_cycle;
+        if (!IsMemory(dst))
+          stall_cycles += kDstCycles;
+      }
+    } break;
+    case Unit::UNIT_MEMORY_IMMEDIATE:
+      v = Data(op.si);
+      break;
+    case Unit::UNIT_MEMORY_OPERAND:
+      v = LoadAs(WidthOf(src, op.si), soperand);
+      break;
+    case Unit::UNIT_REGISTER_POINTER:
+      v = LoadAs(WidthOf(src, op.si), PointerAccess(op.si));
+      break;
+    case Unit::UNIT_PC:
+      // The sequencer has already moved past the instruction and its
+      // operands.
+      v = state_.pc;
+      break;
+    case Unit::UNIT_ABS_IMMEDIATE:
+      v = op.si;
+      break;
+    case Unit::UNIT_ABS_OPERAND:
+      v = soperand;
+      break;
+    case Unit::UNIT_CONTROL:
+      switch ((ControlReg)op.si) {
+        case ControlReg::CTRL_ALU_BUSY:
+          v = 0;
+          for (int alu = 0; alu < kNumALUs; alu++)
+            v |= (IData)(state_.alu_ready[alu] > read_cycle) << alu;
+          break;
+        case ControlReg::CTRL_LOOP_START:
+          v = state_.loop_start;
+          break;
+        case ControlReg::CTRL_LOOP_END:
+          v = state_.loop_end;
+          break;
+        case ControlReg::CTRL_LOOP_COUNT:
+          v = state_.loop_count;
+          break;
+        case ControlReg::CTRL_IRQ_ENABLE:
+          v = state_.irq_enable;
+          break;
+        case ControlReg::CTRL_IRQ_PENDING:
+          v = state_.irq_lines;
+          break;
+        case ControlReg::CTRL_IRQ_VECTOR:
+          v = state_.irq_vector;
+          break;
+        case ControlReg::CTRL_IRQ_EPC:
+          v = state_.irq_epc;
+          break;
+        default:
+          v = op.si < kNumPerfCounters ? state_.perf[op.si] : 0;
+          break;
+      }
+      break;
+    case Unit::UNIT_STACK_PUSH_POP:
+      v = Stack(0);
+      state_.stack_ptr = (state_.stack_ptr - 1) % kStackDepth;
+      break;
+    case Unit::UNIT_STACK_INDEX:
+      v = Stack(op.si);
+      break;
+    default:
+      break;
+  }
+
+  state_.src_value = v;
+  last_store_.reset();
+
+  // Counted before the destination is written, so that writing a counter
+  // overrides the instruction's own contribution, as in perf_counters.sv.
+  const int cycles = header_cycles + Cycles(op) + stall_cycles;
+  CountRetired(src, dst, cycles);
+
+  switch (dst) {
+    case Unit::UNIT_REGISTER:
+      state_.regs[op.di % kNumRegisters] = v;
+      break;
+    case Unit::UNIT_ALU_LEFT:
+      state_.alu_left[op.di % kNumALUs] = v;
+      break;
+    case Unit::UNIT_ALU_RIGHT:
+      state_.alu_right[op.di % kNumALUs] = v;
+      break;
+    case Unit::UNIT_ALU_OPERATOR:
+      state_.alu_op[op.di % kNumALUs] = (ALUOp)(v & 0xf);
+      break;
+    case Unit::UNIT_MEMORY_IMMEDIATE:
+      Write(op.di, v);
+      break;
+    case Unit::UNIT_MEMORY_OPERAND:
+      StoreAs(WidthOf(dst, op.di), doperand, v);
+      break;
+    case Unit::UNIT_PC:
+      state_.pc = v;
+      break;
+    case Unit::UNIT_CONTROL:
+      switch ((ControlReg)op.di) {
+        case ControlReg::CTRL_LOOP_START:
+          state_.loop_start = v;
+          break;
+        case ControlReg::CTRL_LOOP_END:
+          state_.loop_end = v;
+          break;
+        case ControlReg::CTRL_LOOP_COUNT:
+          state_.loop_count = v;
+          break;
+        case ControlReg::CTRL_IRQ_ENABLE:
+          state_.irq_enable = v & 0xff;
+          break;
+        case ControlReg::CTRL_IRQ_VECTOR:
+          state_.irq_vector = v;
+          break;
+        case ControlReg::CTRL_IRQ_EPC:
+          state_.irq_epc = v;
+          break;
+        case ControlReg::CTRL_IRQ_RETURN:
+          state_.pc = state_.irq_epc;
+          state_.irq_active = false;
+          break;
+        default:
+          if (op.di < kNumPerfCounters)
+            state_.perf[op.di] = v;
+          break;
+      }
+      break;
+    case Unit::UNIT_STACK_PUSH_POP:
+      state_.stack_ptr = (state_.stack_ptr + 1) % kStackDepth;
+      Stack(0) = v;
+      break;
+    case Unit::UNIT_STACK_INDEX:
+      Stack(op.di) = v;
+      break;
+    case Unit::UNIT_REGISTER_POINTER:
+      StoreAs(WidthOf(dst, op.di), PointerAccess(op.di), v);
+      break;
+    default:
+      break;
+  }
+
+  // Written last, so it wins, as in execute.sv.
+  if (pair)
+    WritePaired(*pair, paired_value);
+
+  const auto restart_alu = [&](Unit u, int di) {
+    if (u == Unit::UNIT_ALU_LEFT || u == Unit::UNIT_ALU_RIGHT ||
+        u == Unit::UNIT_ALU_OPERATOR) {
+      const int alu = di % kNumALUs;
+      state_.alu_ready[alu] =
+          cycles_ + cycles + AluLatency(state_.alu_op[alu]);
+    }
+  };
+  restart_alu(dst, op.di);
+  if (pair)
+    restart_alu((Unit)pair->dst_unit, pair->di);
+
+  instructions_++;
+  cycles_ += cycles;
+}
+
+uint64_t Emulator::Run(uint64_t max_instructions) {
+  uint64_t start = instructions_;
+  while (instructions_ - start < max_instructions)
+    Step();
+  return instructions_ - start;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <verilated.h>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "assembler.h"
+
+// An instruction-level model of the TTA, for running software much faster
+// than the Verilated RTL and as a reference to check the RTL against.
+//
+// Instructions decode the same way as rtl/decoder.sv and each unit behaves
+// the way rtl/execute.sv and rtl/alu_unit.sv implement it, quirks included.
+// Program and data memory are word addressed, in the same layout as
+// RAMSim::mem(), so images can be shared between the two.
+//
+// Devices, from kIoBase up, aren't modeled, as what they read back depends
+// on timing: stores to them go nowhere, and loads from them read 0 and are
+// noted in read_device().
+class Emulator {
+ public:
+  static constexpr int kNumRegisters = 32;
+  static constexpr int kNumALUs = 8;
+  static constexpr int kNumPerfCounters = 5;
+  static constexpr int kStackDepth = 256;
+
+  struct State {
+    uint32_t pc = 0;
+    IData regs[kNumRegisters] = {};
+    IData alu_left[kNumALUs] = {};
+    IData alu_right[kNumALUs] = {};
+    ALUOp alu_op[kNumALUs] = {};
+    // Estimated cycle at which each ALU has the result for its current
+    // inputs.
+    uint64_t alu_ready[kNumALUs] = {};
+    // The last value moved by execute. Sources which execute.sv doesn't
+    // implement leave it unchanged, and so transport it again.
+    IData src_value = 0;
+    // Performance counters, indexed by ControlReg. Cycles are the Cycles()
+    // estimate, and data bus stalls are never counted.
+    IData perf[kNumPerfCounters] = {};
+    // The stack, and the number of entries pushed. Both wrap at
+    // kStackDepth, as in execute.sv.
+    IData stack[kStackDepth] = {};
+    uint32_t stack_ptr = 0;
+    // The hardware loop, as in sequencer.sv.
+    IData loop_start = 0;
+    IData loop_end = 0;
+    IData loop_count = 0;
+    // The interrupt unit, as in sequencer.sv, and the lines raised, which
+    // only change through SetIrq().
+    IData irq_enable = 0;
+    IData irq_vector = 0;
+    IData irq_epc = 0;
+    bool irq_active = false;
+    IData irq_lines = 0;
+  };
+
+  // A data memory write.
+  struct Store {
+    IData addr;
+    IData data;
+  };
+
+  // The memories must be a power of two words in size, and not be resized
+  // while the emulator is using them; addresses wrap.
+  Emulator(std::vector<IData>& program, std::vector<IData>& data);
+  Emulator(IData* program,
+           size_t program_size,
+           IData* data,
+           size_t data_size);
+
+  Emulator(Emulator&) = delete;
+
+  void Reset();
+
+  // Execute the instruction at the PC, or at the interrupt vector if an
+  // enabled line is raised and no handler is running.
+  void Step();
+
+  // Raise the interrupt lines set in lines, see IrqSource, and lower the
+  // rest. There are no devices here to raise them.
+  void SetIrq(IData lines) { state_.irq_lines = lines & 0xff; }
+
+  // Execute up to max_instructions, returning how many ran.
+  uint64_t Run(uint64_t max_instructions);
+
+  const State& state() const { return state_; }
+  uint32_t pc() const { return state_.pc; }
+  IData reg(int r) const { return state_.regs[r]; }
+
+  // The data memory write made by the last instruction, if any.
+  const std::optional<Store>& last_store() const { return last_store_; }
+  // Whether the last instruction read a device register.
+  bool read_device() const { return read_device_; }
+
+  uint64_t instructions() const { return instructions_; }
+  uint64_t cycles() const { return cycles_; }
+
+  // Estimated clocks taken by the RTL for an instruction, from the state
+  // machines in sequencer.sv and execute.sv. Excludes waiting on an ALU
+  // which is still busy, and header words, both of which cycles()
+  // includes.
+  static int Cycles(const Instr::OpFormat& op);
+  // The same for a whole instruction, header words included.
+  static int Cycles(const Instr& instr);
+  // Clocks after an ALU's inputs are written before it has op's result.
+  static int AluCycles(ALUOp op);
+
+  static IData ALU(ALUOp op, IData a, IData b);
+
+ private:
+  IData& Data(IData addr) { return data_[addr & data_mask_]; }
+  void Write(IData addr, IData data) {
+    if (addr >= kIoBase)
+      return;
+    Data(addr) = data;
+    last_store_ = Store{addr & (IData)data_mask_, data};
+  }
+  // Sub-word accesses, as in execute.sv. addr is a byte address unless w is
+  // MEM_WORD.
+  IData LoadAs(MemWidth w, IData addr);
+  void StoreAs(MemWidth w, IData addr, IData data);
+  // Address of a register pointer access, updating the register as its
+  // mode says.
+  IData PointerAccess(unsigned short immediate);
+  // The move carried by a bundle header.
+  IData PairedSource(const Instr::PairFormat& h) const;
+  void WritePaired(const Instr::PairFormat& h, IData v);
+  // Update the performance counters for an instruction retiring.
+  void CountRetired(Unit src, Unit dst, int cycles);
+  IData Fetch() { return program_[state_.pc++ & program_mask_]; }
+  // Entry below_top entries down from the top of the stack.
+  IData& Stack(uint32_t below_top) {
+    return state_.stack[(state_.stack_ptr - 1 - below_top) % kStackDepth];
+  }
+
+  IData* const program_;
+  IData* const data_;
+  const size_t program_mask_;
+  const size_t data_mask_;
+
+  State state_;
+  std::optional<Store> last_store_;
+  bool read_device_ = false;
+  uint64_t instructions_ = 0;
+  uint64_t cycles_ = 0;
+};
@@ -0,0 +1,372 @@
+#include "emulator.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <iterator>
+
+#include "assembler.h"
+#include "test_programs.h"
+
+// Runs the same kinds of programs as tta_test, but against the functional
+// model rather than the RTL.
+
+class EmulatorTest : public ::testing::Test {
+ public:
+  EmulatorTest() : prg_(1024), ram_(1024), emu_(prg_, ram_) {}
+
+ protected:
+  void Load(const Program& program, uint32_t addr = 0) {
+    Instr::Assemble(program, prg_.data() + addr, prg_.size() - addr);
+  }
+
+  // Load t, run it through, and check what it leaves.
+  void Run(const TestProgram& t) {
+    Load(t.program);
+    for (const auto& [addr, value] : t.memory)
+      ram_[addr] = value;
+    emu_.Run(t.retired);
+    for (const auto& [r, value] : t.regs)
+      EXPECT_EQ(emu_.reg(r), value) << "R" << r;
+    for (const auto& [addr, value] : t.results)
+      EXPECT_EQ(ram_[addr], value) << "at " << addr;
+  }
+
+  std::vector<IData> prg_;
+  std::vector<IData> ram_;
+  Emulator emu_;
+};
+
+TEST_F(EmulatorTest, RegisterSetAbsMemorySetAbs) {
+  Load({Instr()
+            .Src(Unit::UNIT_ABS_IMMEDIATE)
+            .Si(666)
+            .Dst(Unit::UNIT_REGISTER)
+            .Di(0),
+        Instr()
+            .Src(Unit::UNIT_REGISTER)
+            .Si(0)
+            .Dst(Unit::UNIT_MEMORY_IMMEDIATE)
+            .Di(123)});
+  EXPECT_EQ(emu_.Run(2), 2);
+  EXPECT_EQ(emu_.reg(0), 666);
+  EXPECT_EQ(ram_[123], 666);
+  EXPECT_EQ(emu_.pc(), 2);
+}
+
+// The same program, assembled at compile time.
+constexpr IData kConstexprProgram[] = {
+    Instr::Encode(Unit::UNIT_ABS_IMMEDIATE, 666, Unit::UNIT_REGISTER, 0),
+    Instr::EncodeGuard(Unit::UNIT_REGISTER, 0, false),
+    Instr::EncodePair(Unit::UNIT_REGISTER, 0, Unit::UNIT_REGISTER, 2),
+    Instr::Encode(Unit::UNIT_REGISTER, 0, Unit::UNIT_MEMORY_OPERAND, 0),
+    123,
+};
+static_assert(kConstexprProgram[0] == 0x000329ab);
+
+TEST_F(EmulatorTest, ConstexprAssembly) {
+  const Program program = {
+      Instr()
+          .Src(Unit::UNIT_ABS_IMMEDIATE)
+          .Si(666)
+          .Dst(Unit::UNIT_REGISTER)
+          .Di(0),
+      Instr()
+          .Src(Unit::UNIT_REGISTER)
+          .Si(0)
+          .Dst(Unit::UNIT_MEMORY_OPERAND)
+          .Doperand(123)
+          .Pair(Instr()
+                    .Src(Unit::UNIT_REGISTER)
+                    .Si(0)
+                    .Dst(Unit::UNIT_REGISTER)
+                    .Di(2))
+          .If(Unit::UNIT_REGISTER, 0)};
+  ASSERT_EQ(Instr::Size(program), std::size(kConstexprProgram));
+  IData code[std::size(kConstexprProgram)];
+  EXPECT_EQ(Instr::Assemble(program, code, std::size(code)),
+            std::size(kConstexprProgram));
+  EXPECT_TRUE(std::equal(std::begin(code), std::end(code),
+                         std::begin(kConstexprProgram)));
+
+  std::copy(std::begin(kConstexprProgram), std::end(kConstexprProgram),
+            prg_.begin());
+  EXPECT_EQ(emu_.Run(2), 2);
+  EXPECT_EQ(ram_[123], 666);
+  EXPECT_EQ(emu_.reg(2), 666);
+}
+
+TEST_F(EmulatorTest, MemOperandToMemOperand) {
+  Load({Instr()
+            .Src(Unit::UNIT_MEMORY_OPERAND)
+            .Soperand(123)
+            .Dst(Unit::UNIT_MEMORY_OPERAND)
+            .Doperand(124),
+        Instr().Src(Unit::UNIT_PC).Dst(Unit::UNIT_REGISTER).Di(1)});
+  ram_[123] = 666;
+  emu_.Run(2);
+  EXPECT_EQ(ram_[124], 666);
+  EXPECT_EQ(emu_.reg(1), 4);
+}
+
+TEST_F(EmulatorTest, PointerValToMemImmediate) {
+  Load({Instr()
+            .Src(Unit::UNIT_ABS_IMMEDIATE)
+            .Si(666)
+            .Dst(Unit::UNIT_MEMORY_IMMEDIATE)
+            .Di(123),
+        Instr()
+            .Src(Unit::UNIT_ABS_IMMEDIATE)
+            .Si(123)
+            .Dst(Unit::UNIT_REGISTER)
+            .Di(1),
+        Instr()
+            .Src(Unit::UNIT_REGISTER_POINTER)
+            .Si(1)
+            .Dst(Unit::UNIT_MEMORY_IMMEDIATE)
+            .Di(124)});
+  emu_.Run(3);
+  EXPECT_EQ(ram_[124], 666);
+}
+
+TEST_F(EmulatorTest, AluAddition) {
+  Load({Instr()
+            .Src(Unit::UNIT_ABS_IMMEDIATE)
+            .Si(666)
+            .Dst(Unit::UNIT_ALU_LEFT)
+            .Di(3),
+        Instr()
+            .Src(Unit::UNIT_ABS_IMMEDIATE)
+            .Si(111)
+            .Dst(Unit::UNIT_ALU_RIGHT)
+            .Di(3),
+        Instr()
+            .Src(Unit::UNIT_ABS_IMMEDIATE)
+            .Si((int)ALUOp::ALU_ADD)
+            .Dst(Unit::UNIT_ALU_OPERATOR)
+            .Di(3),
+        Instr()
+            .Src(Unit::UNIT_ALU_RESULT)
+            .Si(3)
+            .Dst(Unit::UNIT_MEMORY_IMMEDIATE)
+            .Di(123)});
+  emu_.Run(4);
+  EXPECT_EQ(ram_[123], 777);
+}
+
+TEST_F(EmulatorTest, JumpToPC) {
+  Load({Instr()
+            .Src(Unit::UNIT_ABS_IMMEDIATE)
+            .Si(10)
+            .Dst(Unit::UNIT_PC),
+        Instr()
+            .Src(Unit::UNIT_ABS_IMMEDIATE)
+            .Si(1)
+            .Dst(Unit::UNIT_REGISTER)
+            .Di(0)});
+  Load({Instr()
+            .Src(Unit::UNIT_ABS_IMMEDIATE)
+            .Si(2)
+            .Dst(Unit::UNIT_REGISTER)
+            .Di(0)},
+       10);
+  emu_.Run(2);
+  EXPECT_EQ(emu_.reg(0), 2);
+  EXPECT_EQ(emu_.pc(), 11);
+}
+
+// The ALU reproduces alu_unit.sv, not what the operator names suggest.
+TEST(EmulatorALUTest, MatchesRTL) {
+  EXPECT_EQ(Emulator::ALU(ALUOp::ALU_SUB, 1, 2), 0xffffffff);
+  EXPECT_EQ(Emulator::ALU(ALUOp::ALU_DIV, 7, 0), 0);
+  EXPECT_EQ(Emulator::ALU(ALUOp::ALU_MOD, 7, 3), 1);
+  EXPECT_EQ(Emulator::ALU(ALUOp::ALU_SL, 1, 40), 0);
+  EXPECT_EQ(Emulator::ALU(ALUOp::ALU_SRA, 0x80000000, 31), 1);
+  EXPECT_EQ(Emulator::ALU(ALUOp::ALU_AND, 2, 4), 1);
+  EXPECT_EQ(Emulator::ALU(ALUOp::ALU_OR, 0, 0), 0);
+  EXPECT_EQ(Emulator::ALU(ALUOp::ALU_XOR, 7, 0), 1);
+  EXPECT_EQ(Emulator::ALU(ALUOp::ALU_GT, 0xffffffff, 1), 1);
+}
+
+TEST_F(EmulatorTest, PerfCounters) {
+  Run(PerfCountersProgram());
+  EXPECT_GT(ram_[203], 0);
+}
+
+// Pushes and pops move the top of the stack; peeks and pokes reach below it
+// without moving it.
+TEST_F(EmulatorTest, Stack) {
+  Run(StackProgram());
+  EXPECT_EQ(emu_.state().stack_ptr, 0);
+}
+
+// Byte and halfword accesses take byte addresses, and extend as asked.
+TEST_F(EmulatorTest, SubWordAccess) {
+  Run(SubWordAccessProgram());
+}
+
+// Width codes with no meaning move whole words, at byte addresses, both
+// ways.
+TEST_F(EmulatorTest, UndefinedWidth) {
+  const MemWidth kUndefined = (MemWidth)5;
+  Load({Instr()
+            .Src(Unit::UNIT_ABS_IMMEDIATE)
+            .Si(0x123)
+            .Dst(Unit::UNIT_MEMORY_OPERAND)
+            .DstWidth(kUndefined)
+            .Doperand(4 * 30 + 1),
+        Instr()
+            .Src(Unit::UNIT_MEMORY_OPERAND)
+            .SrcWidth(kUndefined)
+            .Soperand(4 * 30 + 3)
+            .Dst(Unit::UNIT_REGISTER)
+            .Di(1)});
+  emu_.Run(2);
+  EXPECT_EQ(ram_[30], 0x123);
+  EXPECT_EQ(ram_[4 * 30 + 1], 0);
+  EXPECT_EQ(emu_.reg(1), 0x123);
+}
+
+// Devices aren't modeled: their stores go nowhere, and their loads read 0,
+// and say so.
+TEST_F(EmulatorTest, Devices) {
+  const uint32_t kConsole = (uint32_t)ConsoleReg::CONSOLE_DATA;
+  const uint32_t kStatus = (uint32_t)UartReg::UART_STATUS;
+  Load({Instr()
+            .Src(Unit::UNIT_ABS_IMMEDIATE)
+            .Si('A')
+            .Dst(Unit::UNIT_MEMORY_OPERAND)
+            .Doperand(kConsole),
+        Instr()
+            .Src(Unit::UNIT_ABS_IMMEDIATE)
+            .Si(5)
+            .Dst(Unit::UNIT_REGISTER)
+            .Di(1),
+        Instr()
+            .Src(Unit::UNIT_MEMORY_OPERAND)
+            .Soperand(kStatus)
+            .Dst(Unit::UNIT_REGISTER)
+            .Di(1)});
+  emu_.Step();
+  EXPECT_FALSE(emu_.last_store());
+  EXPECT_EQ(ram_[kConsole % ram_.size()], 0);
+  emu_.Step();
+  EXPECT_FALSE(emu_.read_device());
+  emu_.Step();
+  EXPECT_TRUE(emu_.read_device());
+  EXPECT_EQ(emu_.reg(1), 0);
+}
+
+// The console program tta_test runs gets as far as its halt, without
+// touching data memory.
+TEST_F(EmulatorTest, Console) {
+  const TestProgram t = ConsoleProgram(30);
+  Run(t);
+  EXPECT_TRUE(emu_.read_device());
+  const uint32_t halt = emu_.pc();
+  emu_.Step();
+  EXPECT_EQ(emu_.pc(), halt);
+  EXPECT_EQ(halt, Instr::Size(t.program) - t.program.back().size());
+  EXPECT_TRUE(std::all_of(ram_.begin(), ram_.end(),
+                          [](IData word) { return word == 0; }));
+}
+
+// Stores through a register pointer, and pointers which step themselves.
+TEST_F(EmulatorTest, PointerUpdate) {
+  Run(PointerUpdateProgram());
+}
+
+// Multiply and divide take several cycles. Reading the result waits for it;
+// CTRL_ALU_BUSY shows which ALUs are still working.
+TEST_F(EmulatorTest, MultiCycleAlu) {
+  Run(MultiCycleAluProgram());
+  EXPECT_GT(emu_.cycles(), 32);
+}
+
+// The emulator makes its moves in order, so has nothing to let past the
+// read, but ends up in the same place.
+TEST_F(EmulatorTest, Scoreboard) {
+  Run(ScoreboardProgram());
+}
+
+// Bundled moves happen alongside the instruction they're paired with.
+TEST_F(EmulatorTest, Bundle) {
+  const TestProgram t = BundleProgram();
+  EXPECT_EQ(t.program[1].size(), 2);
+  Run(t);
+  EXPECT_EQ(Instr::Disassemble(&prg_[2]).ToString(),
+            "ALU0:LEFT := R01 || ALU0:RIGHT := R02");
+  EXPECT_EQ(emu_.instructions(), t.program.size());
+}
+
+// Guarded instructions are squashed when their guard is zero, or with
+// IfNot(), non-zero.
+TEST_F(EmulatorTest, Guard) {
+  const TestProgram t = GuardProgram();
+  EXPECT_EQ(t.program[3].ToString(), "(R02) R05 := #007 || R06 := #008");
+  Run(t);
+  EXPECT_EQ(emu_.pc(), Instr::Size(t.program));  // the program ran to the end
+}
+
+// The sequencer goes round a hardware loop without any instructions to do
+// so; the count is already down by the time the last one of each pass runs.
+TEST_F(EmulatorTest, HardwareLoop) {
+  const TestProgram t = LoopProgram();
+  Run(t);
+  EXPECT_EQ(emu_.instructions(), t.retired);
+  EXPECT_EQ(emu_.pc(), 9);
+}
+
+namespace {
+
+// Sets up a handler for the UART receive interrupt, then idles. The handler
+// notes where it was entered from and the lines raised.
+Program IrqProgram() {
+  auto move = [](Unit src, int si, Unit dst, int di) {
+    return Instr().Src(src).Si(si).Dst(dst).Di(di);
+  };
+  const Unit kImm = Unit::UNIT_ABS_IMMEDIATE;
+  const Unit kCtrl = Unit::UNIT_CONTROL;
+  const Unit kReg = Unit::UNIT_REGISTER;
+  return {
+      move(kImm, 4, kCtrl, (int)ControlReg::CTRL_IRQ_VECTOR),
+      move(kImm, 1 << (int)IrqSource::IRQ_UART_RX, kCtrl,
+           (int)ControlReg::CTRL_IRQ_ENABLE),
+      move(kImm, 2, Unit::UNIT_PC, 0),  // 2
+      move(kImm, 7, kReg, 3),
+      move(kCtrl, (int)ControlReg::CTRL_IRQ_EPC, kReg, 1),  // 4
+      move(kCtrl, (int)ControlReg::CTRL_IRQ_PENDING, kReg, 2),
+      move(kImm, 0, kCtrl, (int)ControlReg::CTRL_IRQ_RETURN),
+  };
+}
+
+}  // namespace
+
+// An enabled line takes the next instruction to the vector, and the handler
+// back to where it came from; lines held up don't interrupt the handler
+// itself.
+TEST_F(EmulatorTest, Interrupt) {
+  Load(IrqProgram());
+  EXPECT_EQ(emu_.Run(3), 3);
+  EXPECT_EQ(emu_.pc(), 2);
+
+  const IData rx = 1 << (int)IrqSource::IRQ_UART_RX;
+  const IData tx = 1 << (int)IrqSource::IRQ_UART_TX_EMPTY;
+  emu_.SetIrq(tx);  // Not enabled
+  emu_.Run(1);
+  EXPECT_EQ(emu_.pc(), 2);
+  emu_.SetIrq(rx | tx);
+  emu_.Run(3);
+  EXPECT_EQ(emu_.reg(1), 2);
+  EXPECT_EQ(emu_.reg(2), rx | tx);
+  EXPECT_EQ(emu_.pc(), 2);
+  EXPECT_FALSE(emu_.state().irq_active);
+
+  // Still raised, so straight back in.
+  emu_.Run(1);
+  EXPECT_EQ(emu_.pc(), 5);
+  emu_.SetIrq(0);
+  emu_.Run(3);
+  EXPECT_EQ(emu_.pc(), 2);
+  EXPECT_EQ(emu_.reg(3), 0);
+}
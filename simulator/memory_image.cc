@@ -0,0 +1,364 @@
+#include "memory_image.h"
+
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <elf.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+size_t RoundToPages(size_t bytes) {
+  const size_t page = sysconf(_SC_PAGESIZE);
+  return (bytes + page - 1) / page * page;
+}
+
+bool ReadFile(const std::string& filename, std::string* contents) {
+  std::ifstream in(filename, std::ios::binary);
+  if (!in) {
+    PLOG(ERROR) << "Opening " << filename;
+    return false;
+  }
+  std::ostringstream s;
+  s << in.rdbuf();
+  *contents = s.str();
+  return true;
+}
+
+int HexDigit(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+// Unknown bits, which two-state simulation makes zero.
+bool UnknownDigit(char c) {
+  return c == 'x' || c == 'X' || c == 'z' || c == 'Z';
+}
+
+}  // namespace
+
+MemoryImage::MemoryImage(size_t words)
+    : size_(words),
+      map_bytes_(RoundToPages(words * sizeof(IData))),
+      touched_((words + kPageWords - 1) / kPageWords) {
+  void* m = mmap(nullptr, map_bytes_, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  PCHECK(m != MAP_FAILED) << "Mapping " << words << " words";
+  words_ = static_cast<IData*>(m);
+}
+
+MemoryImage::~MemoryImage() {
+  munmap(words_, map_bytes_);
+}
+
+bool MemoryImage::Map(const std::string& filename) {
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    PLOG(ERROR) << "Opening " << filename;
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    PLOG(ERROR) << "Reading the size of " << filename;
+    close(fd);
+    return false;
+  }
+  const size_t bytes = std::min<size_t>(st.st_size, size_ * sizeof(IData));
+  if (bytes < (size_t)st.st_size)
+    LOG(WARNING) << filename << " is larger than the " << size_
+                 << " word memory; only its start is used";
+
+  // So what follows the file reads as zero.
+  Clear();
+  // The last page of the file reads as zero past its end.
+  const size_t file_bytes = RoundToPages(bytes);
+  if (file_bytes != 0) {
+    void* m = mmap(words_, file_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+             fd, 0);
+    if (m == MAP_FAILED) {
+      PLOG(ERROR) << "Mapping " << filename;
+      close(fd);
+      return false;
+    }
+  }
+  close(fd);
+
+  const size_t file_pages = (bytes / sizeof(IData) + kPageWords - 1) / kPageWords;
+  std::fill(touched_.begin(),
+            touched_.begin() + std::min(file_pages, touched_.size()), true);
+  return true;
+}
+
+void MemoryImage::Clear() {
+  void* m = mmap(words_, map_bytes_, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+  PCHECK(m != MAP_FAILED) << "Clearing " << size_ << " words";
+  std::fill(touched_.begin(), touched_.end(), false);
+}
+
+void MemoryImage::RandomizeOnTouch(unsigned seed) {
+  randomize_ = true;
+  rng_.seed(seed);
+}
+
+void MemoryImage::Touch(size_t page) {
+  touched_[page] = true;
+  if (!randomize_)
+    return;
+  const size_t end = std::min(size_, (page + 1) * kPageWords);
+  for (size_t i = page * kPageWords; i < end; i++)
+    words_[i] = rng_() % 255;
+}
+
+bool MemoryImage::Snapshot(const std::string& filename) const {
+  // Truncating a file which is mapped would take the pages not yet copied
+  // out from under the mapping.
+  std::string temp = filename + ".XXXXXX";
+  const int fd = mkstemp(temp.data());
+  if (fd < 0) {
+    PLOG(ERROR) << "Creating a file alongside " << filename;
+    return false;
+  }
+  const size_t bytes = size_ * sizeof(IData);
+  const size_t page = sysconf(_SC_PAGESIZE);
+  const char* p = reinterpret_cast<const char*>(words_);
+  static const std::vector<char> zeros(page);
+  bool ok = true;
+  for (size_t off = 0; ok && off < bytes; off += page) {
+    const size_t n = std::min(page, bytes - off);
+    // Reading an untouched page maps the shared zero page, and allocates
+    // nothing.
+    if (memcmp(p + off, zeros.data(), n) == 0)
+      continue;
+    ok = pwrite(fd, p + off, n, off) == (ssize_t)n;
+  }
+  ok = ok && ftruncate(fd, bytes) == 0 && fchmod(fd, 0644) == 0;
+  if (!ok)
+    PLOG(ERROR) << "Writing " << temp;
+  ok = close(fd) == 0 && ok;
+  if (ok && rename(temp.c_str(), filename.c_str()) != 0) {
+    PLOG(ERROR) << "Renaming " << temp << " to " << filename;
+    ok = false;
+  }
+  if (!ok)
+    unlink(temp.c_str());
+  return ok;
+}
+
+size_t MemoryImage::Prepare(size_t addr, size_t n, const std::string& what) {
+  if (addr >= size_) {
+    if (n != 0)
+      LOG(WARNING) << what << ": " << n << " words at " << addr
+                   << " are outside the " << size_ << " word memory";
+    return 0;
+  }
+  if (n > size_ - addr) {
+    LOG(WARNING) << what << ": " << n - (size_ - addr) << " words from "
+                 << size_ << " are outside the memory";
+    n = size_ - addr;
+  }
+  // Words alongside those written still get their garbage.
+  for (size_t page = addr / kPageWords;
+       n != 0 && page <= (addr + n - 1) / kPageWords; page++) {
+    if (!touched_[page])
+      Touch(page);
+  }
+  return n;
+}
+
+void MemoryImage::Write(size_t addr, const IData* words, size_t n) {
+  n = Prepare(addr, n, "Write");
+  memcpy(words_ + addr, words, n * sizeof(IData));
+}
+
+IData* MemoryImage::Span(size_t addr, size_t* n) {
+  *n = Prepare(addr, *n, "Span");
+  return words_ + std::min(addr, size_);
+}
+
+void MemoryImage::WriteBytes(size_t offset,
+                             const char* bytes,
+                             size_t n,
+                             size_t zeros,
+                             const std::string& what) {
+  const size_t addr = offset / sizeof(IData);
+  const size_t total = n + zeros;
+  const size_t words =
+      (offset + total + sizeof(IData) - 1) / sizeof(IData) - addr;
+  const size_t fit = Prepare(addr, words, what) * sizeof(IData);
+  const size_t start = offset - addr * sizeof(IData);
+  if (fit <= start)
+    return;
+  char* p = reinterpret_cast<char*>(words_) + offset;
+  const size_t room = fit - start;
+  memcpy(p, bytes, std::min(n, room));
+  if (room > n)
+    memset(p + n, 0, std::min(zeros, room - n));
+}
+
+bool MemoryImage::LoadBinary(const std::string& filename, size_t addr) {
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    PLOG(ERROR) << "Opening " << filename;
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    PLOG(ERROR) << "Reading the size of " << filename;
+    close(fd);
+    return false;
+  }
+  if (st.st_size % sizeof(IData) != 0)
+    LOG(WARNING) << filename << " isn't a whole number of words";
+  size_t words = (st.st_size + sizeof(IData) - 1) / sizeof(IData);
+  words = Prepare(addr, words, filename);
+  // Straight into place.
+  char* p = reinterpret_cast<char*>(words_ + addr);
+  size_t left = std::min<size_t>(st.st_size, words * sizeof(IData));
+  bool ok = true;
+  while (ok && left != 0) {
+    const ssize_t got = read(fd, p, left);
+    ok = got > 0;
+    p += std::max<ssize_t>(got, 0);
+    left -= std::max<ssize_t>(got, 0);
+  }
+  if (!ok)
+    PLOG(ERROR) << "Reading " << filename;
+  close(fd);
+  return ok;
+}
+
+bool MemoryImage::LoadHex(const std::string& filename) {
+  std::string text;
+  if (!ReadFile(filename, &text))
+    return false;
+
+  static const char kClose[] = "*/";
+  // One pass over the text, writing each word as it's finished.
+  size_t addr = 0;
+  size_t dropped = 0;
+  size_t unknown = 0;
+  const char* p = text.data();
+  const char* const end = p + text.size();
+  while (p != end) {
+    if (isspace(*p)) {
+      p++;
+    } else if (*p == '/' && p + 1 != end && p[1] == '/') {
+      p = std::find(p, end, '\n');
+    } else if (*p == '/' && p + 1 != end && p[1] == '*') {
+      const char* close = std::search(p + 2, end, kClose, kClose + 2);
+      p = close == end ? end : close + 2;
+    } else {
+      const bool marker = *p == '@';
+      if (marker)
+        p++;
+      uint32_t value = 0;
+      bool has_unknown = false;
+      const char* start = p;
+      for (; p != end && !isspace(*p) && *p != '/'; p++) {
+        if (*p == '_')
+          continue;
+        int d = HexDigit(*p);
+        if (UnknownDigit(*p)) {
+          has_unknown = true;
+          d = 0;
+        }
+        if (d < 0) {
+          LOG(ERROR) << filename << ": '" << *p << "' in a hex number, at byte "
+                     << p - text.data();
+          return false;
+        }
+        if (value >> 28 != 0) {
+          LOG(ERROR) << filename << ": " << std::string(start, p + 1)
+                     << "... is wider than 32 bits, at byte "
+                     << start - text.data();
+          return false;
+        }
+        value = value << 4 | d;
+      }
+      unknown += has_unknown && !marker;
+      if (p == start) {
+        LOG(ERROR) << filename << ": address marker without an address, at byte "
+                   << p - text.data();
+        return false;
+      }
+      if (marker) {
+        addr = value;
+      } else if (addr < size_) {
+        (*this)[addr++] = value;
+      } else {
+        addr++;
+        dropped++;
+      }
+    }
+  }
+  if (dropped)
+    LOG(WARNING) << filename << ": " << dropped << " words are outside the "
+                 << size_ << " word memory";
+  if (unknown)
+    LOG(WARNING) << filename << ": " << unknown
+                 << " words have x or z digits, which read as 0";
+  return true;
+}
+
+bool MemoryImage::LoadElf(const std::string& filename) {
+  std::string file;
+  if (!ReadFile(filename, &file))
+    return false;
+  Elf32_Ehdr eh;
+  if (file.size() < sizeof(eh) || memcmp(file.data(), ELFMAG, SELFMAG) != 0) {
+    LOG(ERROR) << filename << " isn't an ELF file";
+    return false;
+  }
+  memcpy(&eh, file.data(), sizeof(eh));
+  if (eh.e_ident[EI_CLASS] != ELFCLASS32 ||
+      eh.e_ident[EI_DATA] != ELFDATA2LSB) {
+    LOG(ERROR) << filename << " isn't little endian 32-bit ELF";
+    return false;
+  }
+  for (int i = 0; i < eh.e_phnum; i++) {
+    Elf32_Phdr ph;
+    const size_t at = eh.e_phoff + (size_t)i * eh.e_phentsize;
+    if (at + sizeof(ph) > file.size()) {
+      LOG(ERROR) << filename << ": program header " << i << " is truncated";
+      return false;
+    }
+    memcpy(&ph, file.data() + at, sizeof(ph));
+    if (ph.p_type != PT_LOAD)
+      continue;
+    if ((size_t)ph.p_offset + ph.p_filesz > file.size() ||
+        ph.p_memsz < ph.p_filesz) {
+      LOG(ERROR) << filename << ": segment " << i << " is truncated";
+      return false;
+    }
+    // Addresses are bytes there, and words here.
+    WriteBytes(ph.p_paddr, file.data() + ph.p_offset, ph.p_filesz,
+               ph.p_memsz - ph.p_filesz, filename);
+  }
+  return true;
+}
+
+bool MemoryImage::Load(const std::string& filename) {
+  char magic[SELFMAG] = {};
+  std::ifstream(filename, std::ios::binary).read(magic, SELFMAG);
+  if (memcmp(magic, ELFMAG, SELFMAG) == 0)
+    return LoadElf(filename);
+  const std::string ext = ".bin";
+  if (filename.size() >= ext.size() &&
+      filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0)
+    return LoadBinary(filename);
+  return LoadHex(filename);
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <glog/logging.h>
+#include <verilated.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// Word-addressed memory for the bus models. It's mapped rather than
+// allocated, so memory which is never touched costs nothing, and images on
+// disk can be used in place without being read in.
+class MemoryImage {
+ public:
+  // Words are zero until written; the kernel only finds pages for them once
+  // touched.
+  explicit MemoryImage(size_t words);
+  ~MemoryImage();
+
+  MemoryImage(MemoryImage&) = delete;
+
+  // Use the words in filename, host byte order, as the image's first words,
+  // and zero beyond them. The file is paged in as it's read, and written
+  // pages are copied, so it's never changed; see Snapshot(). Returns false,
+  // having logged why, if it can't be mapped.
+  bool Map(const std::string& filename);
+
+  // Zero every word, handing back the pages they took.
+  void Clear();
+
+  // From now on, fill pages with garbage the first time they're accessed
+  // through operator[], as real memory often looks. Pages mapped from a
+  // file, loaded, written or already accessed other than through data(),
+  // are left as they are.
+  void RandomizeOnTouch(unsigned seed);
+
+  // Write the whole image to filename, in the form Map() takes. Runs of
+  // zero pages are left as holes. The file is written alongside and renamed
+  // into place, so it may be the one mapped. Returns false, having logged
+  // why, on failure.
+  bool Snapshot(const std::string& filename) const;
+
+  // Loaders, each filling the image straight from the file read in one go;
+  // words outside the image are dropped with a warning. All return false,
+  // having logged why, if the file can't be read or makes no sense.
+  //
+  // Host order words, as Snapshot() writes, from addr.
+  bool LoadBinary(const std::string& filename, size_t addr = 0);
+  // $readmemh text, as assembler.py writes for bootmem.mem: whitespace
+  // separated hex words, with @address markers and comments. Words wider
+  // than 32 bits are an error; x and z digits read as 0, with a warning.
+  bool LoadHex(const std::string& filename);
+  // The PT_LOAD segments of a little endian 32-bit ELF file, each at its
+  // physical address divided by four, with memory past the end of the file
+  // data (.bss) cleared.
+  bool LoadElf(const std::string& filename);
+  // Whichever of those suits the file: ELF by its magic number, binary for
+  // ".bin" files, and $readmemh otherwise.
+  bool Load(const std::string& filename);
+
+  // Copy n words in at addr, as far as they fit.
+  void Write(size_t addr, const IData* words, size_t n);
+  // Or have them written in place, e.g. by Instr::Assemble(): readies up to
+  // *n words at addr for writing through the pointer returned, setting *n to
+  // how many of them are in the image.
+  IData* Span(size_t addr, size_t* n);
+
+  // Checkpoint the contents to out, and restore them from in, for any
+  // stream with write(const void*, size_t) and read(void*, size_t), such as
+  // VerilatedSave and VerilatedRestore. Zero pages are left out. Garbage
+  // for pages first touched after a restore comes from a fresh sequence.
+  template <typename Out>
+  void Save(Out& out) const {
+    uint64_t size = size_;
+    out.write(&size, sizeof(size));
+    out.write(&randomize_, sizeof(randomize_));
+    static const IData kZeros[kPageWords] = {};
+    for (size_t page = 0; page < touched_.size(); page++) {
+      const size_t n = PageWords(page);
+      bool touched = touched_[page];
+      bool used = memcmp(words_ + page * kPageWords, kZeros,
+                         n * sizeof(IData)) != 0;
+      out.write(&touched, sizeof(touched));
+      out.write(&used, sizeof(used));
+      if (used)
+        out.write(words_ + page * kPageWords, n * sizeof(IData));
+    }
+  }
+  template <typename In>
+  void Restore(In& in) {
+    uint64_t size;
+    in.read(&size, sizeof(size));
+    CHECK_EQ(size, size_) << "Checkpoint is of a different size memory";
+    in.read(&randomize_, sizeof(randomize_));
+    Clear();
+    for (size_t page = 0; page < touched_.size(); page++) {
+      bool touched, used;
+      in.read(&touched, sizeof(touched));
+      in.read(&used, sizeof(used));
+      touched_[page] = touched;
+      if (used)
+        in.read(words_ + page * kPageWords, PageWords(page) * sizeof(IData));
+    }
+  }
+
+  IData& operator[](size_t addr) {
+    DCHECK_LT(addr, size_);
+    if (!touched_[addr / kPageWords])
+      Touch(addr / kPageWords);
+    return words_[addr];
+  }
+
+  // Direct access, bypassing RandomizeOnTouch().
+  IData* data() { return words_; }
+  IData* begin() { return words_; }
+  IData* end() { return words_ + size_; }
+  size_t size() const { return size_; }
+
+ private:
+  static constexpr size_t kPageWords = 1024;
+
+  // Mark a page as used, filling it with garbage first if randomize_.
+  void Touch(size_t page);
+  size_t PageWords(size_t page) const {
+    return std::min(kPageWords, size_ - page * kPageWords);
+  }
+  // Ready words [addr, addr + n) to be written other than through
+  // operator[], returning how many of them are in the image.
+  size_t Prepare(size_t addr, size_t n, const std::string& what);
+  // Copy bytes in at a byte offset, as far as they fit, clearing zeros
+  // bytes after them.
+  void WriteBytes(size_t offset, const char* bytes, size_t n, size_t zeros,
+                  const std::string& what);
+
+  IData* words_;
+  const size_t size_;
+  // The mapping, whole system pages.
+  const size_t map_bytes_;
+
+  bool randomize_ = false;
+  std::vector<bool> touched_;
+  std::mt19937 rng_;
+};
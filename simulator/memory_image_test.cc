@@ -0,0 +1,263 @@
+#include "memory_image.h"
+
+#include <elf.h>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Pages, as MemoryImage keeps track of them.
+constexpr size_t kPage = 1024;
+
+std::string TempFile(const std::string& name) {
+  return testing::TempDir() + "memory_image_test_" + name;
+}
+
+void WriteWords(const std::string& filename, const std::vector<IData>& words) {
+  std::ofstream(filename, std::ios::binary)
+      .write(reinterpret_cast<const char*>(words.data()),
+             words.size() * sizeof(IData));
+}
+
+std::vector<IData> ReadWords(const std::string& filename) {
+  std::ifstream in(filename, std::ios::binary);
+  std::vector<IData> words;
+  for (IData w; in.read(reinterpret_cast<char*>(&w), sizeof(w));)
+    words.push_back(w);
+  return words;
+}
+
+}  // namespace
+
+TEST(MemoryImageTest, Map) {
+  const std::string file = TempFile("map");
+  WriteWords(file, {1, 2, 3});
+  MemoryImage mem(4 * kPage);
+  mem[5] = 9;
+  ASSERT_TRUE(mem.Map(file));
+  EXPECT_EQ(mem[0], 1);
+  EXPECT_EQ(mem[2], 3);
+  // The rest is zero, the word written before included.
+  EXPECT_EQ(mem[3], 0);
+  EXPECT_EQ(mem[5], 0);
+  EXPECT_EQ(mem[3 * kPage], 0);
+
+  // Writes are the image's own.
+  mem[1] = 7;
+  EXPECT_EQ(ReadWords(file), (std::vector<IData>{1, 2, 3}));
+  EXPECT_FALSE(mem.Map(TempFile("missing")));
+}
+
+// Snapshot() writes what Map() reads back, leaving zero pages as holes.
+TEST(MemoryImageTest, SnapshotRoundTrip) {
+  const std::string file = TempFile("snapshot");
+  const size_t kWords = 256 * kPage;
+  MemoryImage mem(kWords);
+  mem[3] = 0x12345678;
+  mem[kWords - 1] = 42;
+  ASSERT_TRUE(mem.Snapshot(file));
+
+  struct stat st;
+  ASSERT_EQ(stat(file.c_str(), &st), 0);
+  EXPECT_EQ((size_t)st.st_size, kWords * sizeof(IData));
+  EXPECT_LT((size_t)st.st_blocks * 512, (size_t)st.st_size / 8);
+
+  MemoryImage copy(kWords);
+  ASSERT_TRUE(copy.Map(file));
+  EXPECT_TRUE(std::equal(mem.begin(), mem.end(), copy.begin()));
+}
+
+// Over the very file the image is mapped from, with some of its pages not
+// yet copied.
+TEST(MemoryImageTest, SnapshotOverMappedImage) {
+  const std::string file = TempFile("remap");
+  std::vector<IData> words(4 * kPage);
+  for (size_t i = 0; i < words.size(); i++)
+    words[i] = i;
+  WriteWords(file, words);
+  MemoryImage mem(words.size());
+  ASSERT_TRUE(mem.Map(file));
+  mem[kPage] = 0xdead;
+  ASSERT_TRUE(mem.Snapshot(file));
+
+  words[kPage] = 0xdead;
+  EXPECT_EQ(ReadWords(file), words);
+  // What the image still maps is the file as it was.
+  EXPECT_EQ(mem[3 * kPage + 1], 3 * kPage + 1);
+  EXPECT_EQ(mem[kPage], 0xdead);
+}
+
+TEST(MemoryImageTest, RandomizeOnTouch) {
+  const std::string file = TempFile("randomize");
+  WriteWords(file, {5, 6});
+  MemoryImage mem(8 * kPage), again(8 * kPage);
+  ASSERT_TRUE(mem.Map(file));
+  // Written, read and loaded before randomizing, and so kept.
+  mem[2 * kPage] = 1;
+  EXPECT_EQ(mem[3 * kPage], 0);
+  const IData words[] = {7, 8};
+  mem.Write(4 * kPage, words, 2);
+  mem.RandomizeOnTouch(1);
+  again.RandomizeOnTouch(1);
+
+  EXPECT_EQ(mem[0], 5);
+  EXPECT_EQ(mem[2], 0);
+  EXPECT_EQ(mem[2 * kPage], 1);
+  EXPECT_EQ(mem[2 * kPage + 1], 0);
+  EXPECT_EQ(mem[3 * kPage], 0);
+  EXPECT_EQ(mem[4 * kPage + 1], 8);
+  EXPECT_EQ(mem[4 * kPage + 2], 0);
+
+  // The first page touched after that is garbage, and the same garbage for
+  // the same seed; writes around it don't clear the rest.
+  int nonzero = 0;
+  for (size_t i = 0; i < kPage; i++) {
+    nonzero += mem[5 * kPage + i] != 0;
+    EXPECT_EQ(mem[5 * kPage + i], again[i]);
+  }
+  EXPECT_GT(nonzero, 0);
+  mem.Write(6 * kPage, words, 1);
+  EXPECT_EQ(mem[6 * kPage], 7);
+  nonzero = 0;
+  for (size_t i = 1; i < kPage; i++)
+    nonzero += mem[6 * kPage + i] != 0;
+  EXPECT_GT(nonzero, 0);
+}
+
+TEST(MemoryImageTest, LoadHex) {
+  const std::string file = TempFile("hex");
+  std::ofstream(file) << "// bootmem.mem\n"
+                         "0000_0001 2 /* skipped\n over */ 0003\n"
+                         "@10 abcdef01\n"
+                         "@3fe 5 6 7\n";
+  MemoryImage mem(1024);
+  mem[4] = 9;
+  ASSERT_TRUE(mem.Load(file));
+  EXPECT_EQ(mem[0], 1);
+  EXPECT_EQ(mem[1], 2);
+  EXPECT_EQ(mem[2], 3);
+  EXPECT_EQ(mem[4], 9);  // Left alone
+  EXPECT_EQ(mem[0x10], 0xabcdef01);
+  EXPECT_EQ(mem[0x3ff], 6);  // And the 7 dropped
+
+  // Unknown digits read as zero, but say so.
+  std::ofstream(file) << "1x 2 zz";
+  testing::internal::CaptureStderr();
+  ASSERT_TRUE(mem.LoadHex(file));
+  EXPECT_NE(testing::internal::GetCapturedStderr().find("2 words have x or z"),
+            std::string::npos);
+  EXPECT_EQ(mem[0], 0x10);
+  EXPECT_EQ(mem[2], 0);
+
+  // Which is more than can be said for words which don't fit.
+  std::ofstream(file) << "1 123456789";
+  EXPECT_FALSE(mem.LoadHex(file));
+  std::ofstream(file) << "1 00000000f";
+  EXPECT_TRUE(mem.LoadHex(file));
+  EXPECT_EQ(mem[1], 0xf);
+  std::ofstream(file) << "1 q";
+  EXPECT_FALSE(mem.LoadHex(file));
+  std::ofstream(file) << "@ 1";
+  EXPECT_FALSE(mem.LoadHex(file));
+}
+
+TEST(MemoryImageTest, LoadBinary) {
+  const std::string file = TempFile("binary.bin");
+  WriteWords(file, {1, 2, 3});
+  MemoryImage mem(1024);
+  ASSERT_TRUE(mem.Load(file));
+  EXPECT_EQ(mem[2], 3);
+  ASSERT_TRUE(mem.LoadBinary(file, 1022));
+  EXPECT_EQ(mem[1022], 1);
+  EXPECT_EQ(mem[1023], 2);
+
+  // A part word takes the start of the last.
+  std::ofstream(file, std::ios::binary).write("\x01\x02\x03\x04\x05", 5);
+  mem[101] = 0xffffffff;
+  ASSERT_TRUE(mem.LoadBinary(file, 100));
+  EXPECT_EQ(mem[100], 0x04030201);
+  EXPECT_EQ(mem[101] & 0xff, 0x05);
+  EXPECT_FALSE(mem.LoadBinary(TempFile("missing")));
+}
+
+namespace {
+
+// An ELF file with a segment of two words and three of .bss at byte address
+// 0x100, one of three bytes at 0x206, and a note, which isn't loaded.
+std::string TestElf() {
+  Elf32_Ehdr eh = {};
+  memcpy(eh.e_ident, ELFMAG, SELFMAG);
+  eh.e_ident[EI_CLASS] = ELFCLASS32;
+  eh.e_ident[EI_DATA] = ELFDATA2LSB;
+  eh.e_ident[EI_VERSION] = EV_CURRENT;
+  eh.e_type = ET_EXEC;
+  eh.e_version = EV_CURRENT;
+  eh.e_phoff = sizeof(eh);
+  eh.e_ehsize = sizeof(eh);
+  eh.e_phentsize = sizeof(Elf32_Phdr);
+  eh.e_phnum = 3;
+  const size_t data_offset = sizeof(eh) + 3 * sizeof(Elf32_Phdr);
+  const IData words[] = {0x11111111, 0x22222222};
+  const char bytes[] = {0x33, 0x44, 0x55};
+  Elf32_Phdr ph[3] = {};
+  ph[0].p_type = PT_LOAD;
+  ph[0].p_offset = data_offset;
+  ph[0].p_paddr = 0x100;
+  ph[0].p_filesz = sizeof(words);
+  ph[0].p_memsz = sizeof(words) + 3 * sizeof(IData);
+  ph[1].p_type = PT_NOTE;
+  ph[1].p_offset = data_offset;
+  ph[1].p_paddr = 0;
+  ph[1].p_filesz = sizeof(words);
+  ph[1].p_memsz = sizeof(words);
+  ph[2].p_type = PT_LOAD;
+  ph[2].p_offset = data_offset + sizeof(words);
+  ph[2].p_paddr = 0x206;
+  ph[2].p_filesz = sizeof(bytes);
+  ph[2].p_memsz = sizeof(bytes);
+
+  std::string file(reinterpret_cast<const char*>(&eh), sizeof(eh));
+  file.append(reinterpret_cast<const char*>(ph), sizeof(ph));
+  file.append(reinterpret_cast<const char*>(words), sizeof(words));
+  file.append(bytes, sizeof(bytes));
+  return file;
+}
+
+}  // namespace
+
+TEST(MemoryImageTest, LoadElf) {
+  const std::string file = TempFile("elf");
+  const std::string elf = TestElf();
+  std::ofstream(file, std::ios::binary) << elf;
+  MemoryImage mem(1024);
+  for (size_t i = 0; i < 0x100; i++)
+    mem[i] = 0xffffffff;
+  ASSERT_TRUE(mem.Load(file));
+
+  EXPECT_EQ(mem[0], 0xffffffff);  // Not the note
+  EXPECT_EQ(mem[0x3f], 0xffffffff);
+  EXPECT_EQ(mem[0x40], 0x11111111);
+  EXPECT_EQ(mem[0x41], 0x22222222);
+  for (size_t i = 0x42; i < 0x45; i++)
+    EXPECT_EQ(mem[i], 0) << "bss word " << i;
+  EXPECT_EQ(mem[0x45], 0xffffffff);
+  // Bytes 0x206 to 0x208: the top half of word 0x81, and the bottom byte of
+  // 0x82, around which the words are left as they were.
+  EXPECT_EQ(mem[0x81], 0x4433ffff);
+  EXPECT_EQ(mem[0x82], 0xffffff55);
+
+  // Truncated files, and ones which aren't ELF at all.
+  std::ofstream(file, std::ios::binary) << elf.substr(0, elf.size() - 1);
+  EXPECT_FALSE(mem.LoadElf(file));
+  std::ofstream(file, std::ios::binary)
+      << elf.substr(0, sizeof(Elf32_Ehdr) + sizeof(Elf32_Phdr));
+  EXPECT_FALSE(mem.LoadElf(file));
+  std::ofstream(file, std::ios::binary) << "not an ELF file";
+  EXPECT_FALSE(mem.LoadElf(file));
+}
@@ -0,0 +1,387 @@
+#include "optimizer.h"
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <set>
+
+#include "emulator.h"
+
+namespace {
+
+// Things instructions read and write, for ordering them: registers by
+// number, then the ALUs' inputs, the stack and memory.
+enum AluPort { kLeft, kRight, kOperator };
+constexpr int kAluBase = 1 << 12;
+constexpr int kStack = kAluBase + Emulator::kNumALUs * 3;
+constexpr int kMemory = kStack + 1;
+
+int AluInput(unsigned alu, AluPort port) {
+  return kAluBase + alu % Emulator::kNumALUs * 3 + port;
+}
+
+struct Effects {
+  std::vector<int> reads;
+  std::vector<int> writes;
+  // Stays put, see optimizer.h.
+  bool barrier = false;
+  // ALUs whose results are read, and whose inputs are written.
+  std::vector<unsigned> results;
+  std::vector<unsigned> inputs;
+};
+
+// Register pointer accesses read, and may update, their register.
+void PointerEffects(unsigned immediate, Effects* e) {
+  const int r = immediate & 0x1f;
+  e->reads.push_back(r);
+  if ((PtrMode)(immediate >> 6 & 3) != PtrMode::PTR_PLAIN)
+    e->writes.push_back(r);
+  e->writes.push_back(kMemory);
+}
+
+void SourceEffects(Unit u, unsigned i, Effects* e) {
+  switch (u) {
+    case Unit::UNIT_NONE:
+    case Unit::UNIT_ABS_IMMEDIATE:
+    case Unit::UNIT_ABS_OPERAND:
+      break;
+    case Unit::UNIT_REGISTER:
+      e->reads.push_back(i);
+      break;
+    case Unit::UNIT_ALU_LEFT:
+      e->reads.push_back(AluInput(i, kLeft));
+      break;
+    case Unit::UNIT_ALU_RIGHT:
+      e->reads.push_back(AluInput(i, kRight));
+      break;
+    case Unit::UNIT_ALU_RESULT:
+      for (AluPort port : {kLeft, kRight, kOperator})
+        e->reads.push_back(AluInput(i, port));
+      e->results.push_back(i % Emulator::kNumALUs);
+      break;
+    case Unit::UNIT_STACK_PUSH_POP:
+    case Unit::UNIT_STACK_INDEX:
+      e->writes.push_back(kStack);
+      break;
+    case Unit::UNIT_MEMORY_IMMEDIATE:
+    case Unit::UNIT_MEMORY_OPERAND:
+      e->writes.push_back(kMemory);
+      break;
+    case Unit::UNIT_REGISTER_POINTER:
+      PointerEffects(i, e);
+      break;
+    default:
+      e->barrier = true;
+      break;
+  }
+}
+
+void DestinationEffects(Unit u, unsigned i, Effects* e) {
+  switch (u) {
+    case Unit::UNIT_NONE:
+      break;
+    case Unit::UNIT_REGISTER:
+      e->writes.push_back(i);
+      break;
+    case Unit::UNIT_ALU_LEFT:
+    case Unit::UNIT_ALU_RIGHT:
+    case Unit::UNIT_ALU_OPERATOR:
+      e->writes.push_back(AluInput(
+          i, u == Unit::UNIT_ALU_LEFT
+                 ? kLeft
+                 : u == Unit::UNIT_ALU_RIGHT ? kRight : kOperator));
+      e->inputs.push_back(i % Emulator::kNumALUs);
+      break;
+    case Unit::UNIT_STACK_PUSH_POP:
+    case Unit::UNIT_STACK_INDEX:
+      e->writes.push_back(kStack);
+      break;
+    case Unit::UNIT_MEMORY_IMMEDIATE:
+    case Unit::UNIT_MEMORY_OPERAND:
+      e->writes.push_back(kMemory);
+      break;
+    case Unit::UNIT_REGISTER_POINTER:
+      PointerEffects(i, e);
+      break;
+    default:
+      e->barrier = true;
+      break;
+  }
+}
+
+Effects EffectsOf(const Instr& instr) {
+  Effects e;
+  const Instr::OpFormat& op = instr.op();
+  SourceEffects((Unit)op.src_unit, op.si, &e);
+  DestinationEffects((Unit)op.dst_unit, op.di, &e);
+  if (const auto& p = instr.paired()) {
+    SourceEffects((Unit)p->src_unit, p->si, &e);
+    DestinationEffects((Unit)p->dst_unit, p->di, &e);
+  }
+  if (const auto& g = instr.guard())
+    SourceEffects((Unit)g->unit, g->index, &e);
+  return e;
+}
+
+bool Overlap(const std::vector<int>& a, const std::vector<int>& b) {
+  for (int x : a) {
+    if (std::find(b.begin(), b.end(), x) != b.end())
+      return true;
+  }
+  return false;
+}
+
+// Whether b, after a, has to stay after it.
+bool DependsOn(const Effects& b, const Effects& a) {
+  return a.barrier || b.barrier || Overlap(a.writes, b.reads) ||
+         Overlap(a.writes, b.writes) || Overlap(a.reads, b.writes);
+}
+
+// Sources with no side effects, whose moves can go if they're not needed.
+bool IsPure(Unit u) {
+  switch (u) {
+    case Unit::UNIT_NONE:
+    case Unit::UNIT_REGISTER:
+    case Unit::UNIT_ALU_LEFT:
+    case Unit::UNIT_ALU_RIGHT:
+    case Unit::UNIT_ALU_RESULT:
+    case Unit::UNIT_ABS_IMMEDIATE:
+    case Unit::UNIT_ABS_OPERAND:
+    case Unit::UNIT_STACK_INDEX:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Whether instr is a plain move to a register, with nothing else to it.
+bool IsRegisterMove(const Instr& instr) {
+  return (Unit)instr.op().dst_unit == Unit::UNIT_REGISTER &&
+         IsPure((Unit)instr.op().src_unit) && !instr.paired();
+}
+
+// Moves of a value a register already holds, found by numbering the values
+// the block moves around.
+void RemoveNoOps(const Program& block, std::vector<bool>* keep) {
+  int next = 0;
+  std::map<unsigned, int> regs;
+  std::map<uint32_t, int> constants;
+  const auto reg = [&](unsigned r) {
+    return regs.emplace(r, next).second ? next++ : regs[r];
+  };
+  const auto constant = [&](uint32_t v) {
+    return constants.emplace(v, next).second ? next++ : constants[v];
+  };
+  const auto value = [&](Unit u, unsigned i, std::optional<uint32_t> operand) {
+    switch (u) {
+      case Unit::UNIT_REGISTER:
+        return reg(i);
+      case Unit::UNIT_NONE:
+        return constant(0);
+      case Unit::UNIT_ABS_IMMEDIATE:
+        return constant(i);
+      case Unit::UNIT_ABS_OPERAND:
+        if (operand)
+          return constant(*operand);
+        return next++;
+      default:
+        return next++;
+    }
+  };
+
+  for (size_t j = 0; j < block.size(); j++) {
+    const Instr& instr = block[j];
+    const Instr::OpFormat& op = instr.op();
+    const int v = value((Unit)op.src_unit, op.si, instr.soperand());
+    if (IsRegisterMove(instr) && v == reg(op.di)) {
+      (*keep)[j] = false;
+      continue;
+    }
+    // Both moves read before either writes.
+    const auto& p = instr.paired();
+    const int pv = p ? value((Unit)p->src_unit, p->si, {}) : 0;
+    for (int r : EffectsOf(instr).writes) {
+      if (r < kAluBase)
+        regs[r] = next++;
+    }
+    if (!instr.guard()) {
+      if ((Unit)op.dst_unit == Unit::UNIT_REGISTER)
+        regs[op.di] = v;
+      if (p && (Unit)p->dst_unit == Unit::UNIT_REGISTER)
+        regs[p->di] = pv;
+    }
+  }
+}
+
+// Moves to registers which are written again before anything reads them.
+void RemoveDeadMoves(const Program& block, std::vector<bool>* keep) {
+  std::set<int> overwritten;
+  for (size_t j = block.size(); j-- > 0;) {
+    if (!(*keep)[j])
+      continue;
+    const Instr& instr = block[j];
+    if (IsRegisterMove(instr) && !instr.guard() &&
+        overwritten.count(instr.op().di)) {
+      (*keep)[j] = false;
+      continue;
+    }
+    const Effects e = EffectsOf(instr);
+    if (!instr.guard()) {
+      if ((Unit)instr.op().dst_unit == Unit::UNIT_REGISTER)
+        overwritten.insert(instr.op().di);
+      if (instr.paired() &&
+          (Unit)instr.paired()->dst_unit == Unit::UNIT_REGISTER)
+        overwritten.insert(instr.paired()->di);
+    }
+    for (int r : e.reads)
+      overwritten.erase(r);
+  }
+}
+
+// List scheduling: of the moves whose dependencies have run, the one which
+// wouldn't wait on an ALU, then the one with the most clocks of work
+// depending on it, then the first.
+std::vector<size_t> Schedule(const Program& block,
+                             const std::vector<size_t>& kept) {
+  const size_t n = kept.size();
+  std::vector<Effects> effects;
+  std::vector<int> cycles;
+  for (size_t k : kept) {
+    effects.push_back(EffectsOf(block[k]));
+    cycles.push_back(Emulator::Cycles(block[k]));
+  }
+  std::vector<std::vector<size_t>> after(n);
+  std::vector<int> waiting(n, 0);
+  for (size_t j = 0; j < n; j++) {
+    for (size_t i = 0; i < j; i++) {
+      if (DependsOn(effects[j], effects[i])) {
+        after[i].push_back(j);
+        waiting[j]++;
+      }
+    }
+  }
+  std::vector<int> critical(n, 0);
+  for (size_t i = n; i-- > 0;) {
+    int longest = 0;
+    for (size_t j : after[i])
+      longest = std::max(longest, critical[j]);
+    critical[i] = cycles[i] + longest;
+  }
+
+  // Known ALU operations, from operators moved in as immediates.
+  std::vector<ALUOp> alu_op(Emulator::kNumALUs, ALUOp::ALU_NOP);
+  std::vector<int> alu_ready(Emulator::kNumALUs, 0);
+  std::vector<bool> done(n, false);
+  std::vector<size_t> order;
+  int now = 0;
+  while (order.size() < n) {
+    size_t best = n;
+    int best_stall = 0;
+    for (size_t j = 0; j < n; j++) {
+      if (done[j] || waiting[j] != 0)
+        continue;
+      int stall = 0;
+      for (unsigned a : effects[j].results)
+        stall = std::max(stall, alu_ready[a] - now);
+      if (best == n || stall < best_stall ||
+          (stall == best_stall && critical[j] > critical[best])) {
+        best = j;
+        best_stall = stall;
+      }
+    }
+    done[best] = true;
+    order.push_back(kept[best]);
+    for (size_t j : after[best])
+      waiting[j]--;
+
+    const Instr& instr = block[kept[best]];
+    const auto note_operator = [&](Unit dst, unsigned di, Unit src,
+                                   unsigned si) {
+      if (dst == Unit::UNIT_ALU_OPERATOR)
+        alu_op[di % Emulator::kNumALUs] =
+            src == Unit::UNIT_ABS_IMMEDIATE ? (ALUOp)si : ALUOp::ALU_NOP;
+    };
+    note_operator((Unit)instr.op().dst_unit, instr.op().di,
+                  (Unit)instr.op().src_unit, instr.op().si);
+    if (const auto& p = instr.paired())
+      note_operator((Unit)p->dst_unit, p->di, (Unit)p->src_unit, p->si);
+    now += best_stall + cycles[best];
+    for (unsigned a : effects[best].inputs)
+      alu_ready[a] = now + Emulator::AluCycles(alu_op[a]);
+  }
+  return order;
+}
+
+// instr, with operands which fit in 12 bits made immediates.
+Instr ShrinkOperands(const Instr& instr) {
+  const Instr::OpFormat& op = instr.op();
+  const auto shrink = [](Unit u, unsigned i, std::optional<uint32_t> operand,
+                         Unit* unit, unsigned* immediate) {
+    if (!operand || *operand >= 1U << 12U)
+      return false;
+    if (u == Unit::UNIT_ABS_OPERAND)
+      *unit = Unit::UNIT_ABS_IMMEDIATE;
+    else if (u == Unit::UNIT_MEMORY_OPERAND &&
+             (MemWidth)(i >> 8) == MemWidth::MEM_WORD)
+      *unit = Unit::UNIT_MEMORY_IMMEDIATE;
+    else
+      return false;
+    *immediate = *operand;
+    return true;
+  };
+  Unit src = (Unit)op.src_unit, dst = (Unit)op.dst_unit;
+  unsigned si = op.si, di = op.di;
+  const bool src_fits = shrink(src, si, instr.soperand(), &src, &si);
+  const bool dst_fits = shrink(dst, di, instr.doperand(), &dst, &di);
+  if (!src_fits && !dst_fits)
+    return instr;
+
+  Instr out;
+  out.Src(src).Si(si).Dst(dst).Di(di);
+  if (!src_fits && out.UsesSoperand())
+    out.Soperand(*instr.soperand());
+  if (!dst_fits && out.UsesDoperand())
+    out.Doperand(*instr.doperand());
+  if (const auto& p = instr.paired()) {
+    out.Pair(Instr()
+                 .Src((Unit)p->src_unit)
+                 .Si(p->si)
+                 .Dst((Unit)p->dst_unit)
+                 .Di(p->di));
+  }
+  if (const auto& g = instr.guard()) {
+    if (g->invert)
+      out.IfNot((Unit)g->unit, g->index);
+    else
+      out.If((Unit)g->unit, g->index);
+  }
+  return out;
+}
+
+}  // namespace
+
+std::vector<size_t> PlanBlock(const Program& block,
+                              const OptimizerOptions& options) {
+  std::vector<bool> keep(block.size(), true);
+  if (options.remove_moves) {
+    RemoveNoOps(block, &keep);
+    RemoveDeadMoves(block, &keep);
+  }
+  std::vector<size_t> kept;
+  for (size_t j = 0; j < block.size(); j++) {
+    if (keep[j])
+      kept.push_back(j);
+  }
+  if (!options.schedule)
+    return kept;
+  return Schedule(block, kept);
+}
+
+Program OptimizeBlock(const Program& block, const OptimizerOptions& options) {
+  Program out;
+  for (size_t j : PlanBlock(block, options)) {
+    out.push_back(options.shrink_operands ? ShrinkOperands(block[j])
+                                          : block[j]);
+  }
+  return out;
+}
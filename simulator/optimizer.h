@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "assembler.h"
+
+// Optimizations of a basic block: straight-line code only entered at the
+// top, which only its last instruction may leave. Software schedules the
+// ALUs on this core, so by hand this is tedious and easy to get wrong.
+//
+// Moves which touch the PC or UNIT_CONTROL, or read UNIT_ALU_OPERATOR
+// (which passes on the last value moved), stay where they are, with
+// everything else kept on its side of them. Memory and stack accesses keep
+// their order among themselves, as they may be I/O.
+struct OptimizerOptions {
+  // Drop register moves which change nothing, or whose value is overwritten
+  // in the block before anything reads it.
+  bool remove_moves = true;
+  // Reorder independent moves to keep the ALUs busy: inputs written as
+  // early as they can be, and results read once they should be ready, by
+  // the estimates of Emulator::Cycles() and Emulator::AluCycles().
+  bool schedule = true;
+  // Use UNIT_ABS_IMMEDIATE and UNIT_MEMORY_IMMEDIATE for operands which
+  // fit in 12 bits, saving the sequencer an operand fetch.
+  bool shrink_operands = true;
+};
+
+// Which of block's instructions to keep, as indices, in the order they're
+// to run. Operands not yet filled in are taken to be unknown values.
+std::vector<size_t> PlanBlock(const Program& block,
+                              const OptimizerOptions& options = {});
+
+// block, optimized. It can get shorter, so nothing may jump into it.
+Program OptimizeBlock(const Program& block,
+                      const OptimizerOptions& options = {});
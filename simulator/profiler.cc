@@ -0,0 +1,95 @@
+#include "profiler.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "assembler.h"
+
+Profiler::Profiler(const std::vector<uint32_t>& code) {
+  // Room for the words a truncated last instruction would take.
+  std::vector<uint32_t> padded(code);
+  padded.resize(code.size() + 4);
+  for (uint32_t addr = 0; addr < code.size();) {
+    const Instr instr = Instr::Disassemble(&padded[addr]);
+    code_[addr] = {instr.size(), instr.ToString()};
+    addr += instr.size();
+  }
+}
+
+void Profiler::Clock(bool retired, uint32_t start_pc) {
+  clocks_++;
+  pending_++;
+  if (!retired)
+    return;
+  if (start_pc != next_)
+    block_ = start_pc;
+  Entry& e = flat_[start_pc];
+  e.clocks += pending_;
+  e.retired++;
+  folded_[{block_, start_pc}] += pending_;
+  retired_++;
+  pending_ = 0;
+  auto it = code_.find(start_pc);
+  if (it != code_.end())
+    next_ = start_pc + it->second.size;
+  else
+    next_.reset();
+}
+
+std::string Profiler::Name(uint32_t addr) const {
+  std::ostringstream s;
+  s << std::hex << std::setfill('0') << std::setw(8) << addr;
+  auto it = code_.find(addr);
+  if (it != code_.end())
+    s << " " << it->second.disassembly;
+  return s.str();
+}
+
+void Profiler::WriteFlat(std::ostream& out) const {
+  std::vector<std::pair<uint32_t, Entry>> entries(flat_.begin(), flat_.end());
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const auto& a, const auto& b) {
+                     return a.second.clocks > b.second.clocks;
+                   });
+  out << "Clocks: " << clocks_ << ", instructions retired: " << retired_
+      << ", not yet charged: " << pending_ << "\n";
+  out << "      clocks       %     retired  clocks/instr  instruction\n";
+  for (const auto& [addr, e] : entries) {
+    out << std::setw(12) << e.clocks << std::fixed << std::setprecision(2)
+        << std::setw(8) << 100.0 * e.clocks / std::max<uint64_t>(clocks_, 1)
+        << std::setw(12) << e.retired << std::setw(14)
+        << (double)e.clocks / e.retired << "  " << Name(addr) << "\n";
+  }
+}
+
+void Profiler::WriteFolded(std::ostream& out) const {
+  for (const auto& [key, clocks] : folded_) {
+    std::ostringstream block;
+    block << std::hex << std::setfill('0') << std::setw(8) << key.first;
+    out << "block_" << block.str() << ";" << Name(key.second) << " " << clocks
+        << "\n";
+  }
+}
+
+bool Profiler::WriteFiles(const std::string& flat,
+                          const std::string& folded) const {
+  std::ofstream flat_out(flat);
+  WriteFlat(flat_out);
+  if (!flat_out) {
+    LOG(ERROR) << "Can't write profile " << flat;
+    return false;
+  }
+  std::ofstream folded_out(folded);
+  WriteFolded(folded_out);
+  if (!folded_out) {
+    LOG(ERROR) << "Can't write profile " << folded;
+    return false;
+  }
+  LOG(INFO) << "Wrote profile of " << retired_ << " instructions to " << flat
+            << " and " << folded;
+  return true;
+}
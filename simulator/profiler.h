@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Where the clocks of a run go, by instruction. Each bus clock goes to the
+// next instruction to retire, so an instruction is charged for everything
+// between the one before it retiring and itself doing so: its fetch and any
+// waits, on the pipelined core as well.
+//
+// The core shows where each instruction it retires starts, as
+// retire_start_pc_o. The program is read through once from address 0 for
+// the disassembly and size of each; data among the code can throw that off,
+// and instructions it can't place are listed by address alone, each as a
+// block of its own.
+class Profiler {
+ public:
+  // code: the program's words from address 0, as blkram is loaded.
+  explicit Profiler(const std::vector<uint32_t>& code);
+
+  Profiler(Profiler&) = delete;
+
+  // One bus clock, with simtop's instr_retired_o and retire_start_pc_o.
+  void Clock(bool retired, uint32_t start_pc);
+
+  uint64_t clocks() const { return clocks_; }
+  uint64_t retired() const { return retired_; }
+
+  // Instructions by the clocks charged to them, most first, with their
+  // share of the total, how often they retired and their disassembly.
+  void WriteFlat(std::ostream& out) const;
+  // Folded stacks, as flamegraph.pl and speedscope take: one line per
+  // instruction and the basic block it ran in, with its clocks. A block is
+  // named for its start, where a jump or interrupt landed, as the core has
+  // no calls to make a deeper stack from.
+  void WriteFolded(std::ostream& out) const;
+  // Both, to files. Returns false, having logged why, if either can't be
+  // written.
+  bool WriteFiles(const std::string& flat, const std::string& folded) const;
+
+ private:
+  struct Entry {
+    uint64_t clocks = 0;
+    uint64_t retired = 0;
+  };
+
+  struct Code {
+    size_t size;
+    std::string disassembly;
+  };
+
+  // "0000001c R02 := *R01++", or just the address.
+  std::string Name(uint32_t addr) const;
+
+  // What the read-through found, by start.
+  std::map<uint32_t, Code> code_;
+
+  uint64_t clocks_ = 0;
+  uint64_t retired_ = 0;
+  // Clocks since the last retirement.
+  uint64_t pending_ = 0;
+  // Where the last instruction left off, if known, and the block it was in.
+  std::optional<uint32_t> next_;
+  uint32_t block_ = 0;
+  std::map<uint32_t, Entry> flat_;
+  // By block, then instruction.
+  std::map<std::pair<uint32_t, uint32_t>, uint64_t> folded_;
+};
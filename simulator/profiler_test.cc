@@ -0,0 +1,134 @@
+#include "profiler.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "assembler.h"
+#include "emulator.h"
+
+namespace {
+
+// Three times round a hardware loop, then a jump over two instructions to a
+// halt.
+Program JumpAndLoopProgram() {
+  auto move = [](Unit src, int si, Unit dst, int di) {
+    return Instr().Src(src).Si(si).Dst(dst).Di(di);
+  };
+  const Unit kImm = Unit::UNIT_ABS_IMMEDIATE;
+  const Unit kCtrl = Unit::UNIT_CONTROL;
+  const Unit kReg = Unit::UNIT_REGISTER;
+  return {
+      move(kImm, 3, kCtrl, (int)ControlReg::CTRL_LOOP_START),
+      move(kImm, 5, kCtrl, (int)ControlReg::CTRL_LOOP_END),
+      move(kImm, 3, kCtrl, (int)ControlReg::CTRL_LOOP_COUNT),
+      move(kReg, 1, kReg, 2),  // 3
+      move(kImm, 7, kReg, 1),
+      move(kImm, 8, Unit::UNIT_PC, 0),  // 5
+      move(kImm, 1, kReg, 3),
+      move(kImm, 2, kReg, 3),
+      move(kImm, 8, Unit::UNIT_PC, 0),  // 8
+  };
+}
+
+}  // namespace
+
+// Fed the emulator's retirements, with the clocks each took, as simtop
+// would feed it the core's.
+TEST(ProfilerTest, EmulatorRun) {
+  const Program program = JumpAndLoopProgram();
+  std::vector<IData> prg(1024), ram(1024);
+  Instr::Assemble(program, prg.data(), prg.size());
+  const std::vector<uint32_t> code(prg.begin(),
+                                   prg.begin() + Instr::Size(program));
+  Profiler profiler(code);
+  Emulator emu(prg, ram);
+
+  // Where each instruction retired starts, and the clocks up to it.
+  std::vector<std::pair<uint32_t, uint64_t>> run;
+  for (int i = 0; i < 12; i++) {
+    const uint32_t start = emu.pc();
+    const uint64_t cycles = emu.cycles();
+    emu.Step();
+    run.push_back({start, emu.cycles() - cycles});
+    for (uint64_t c = 1; c < run.back().second; c++)
+      profiler.Clock(false, 0);
+    profiler.Clock(true, start);
+  }
+  std::vector<uint32_t> starts;
+  for (const auto& [start, clocks] : run)
+    starts.push_back(start);
+  ASSERT_EQ(starts,
+            (std::vector<uint32_t>{0, 1, 2, 3, 4, 3, 4, 3, 4, 5, 8, 8}));
+  EXPECT_EQ(profiler.clocks(), emu.cycles());
+  EXPECT_EQ(profiler.retired(), 12);
+
+  auto name = [&](uint32_t addr) {
+    std::ostringstream s;
+    s << std::hex << std::setfill('0') << std::setw(8) << addr << " "
+      << Instr::Disassemble(&code[addr]).ToString();
+    return s.str();
+  };
+
+  // The first time round the loop is in the block it falls into from the
+  // top. Going round starts one at the loop start, which carries on past
+  // the loop end once the count runs out; the jump starts another.
+  std::map<std::pair<uint32_t, uint32_t>, uint64_t> blocks;
+  std::map<uint32_t, std::pair<uint64_t, int>> flat;
+  for (size_t i = 0; i < run.size(); i++) {
+    const auto& [start, clocks] = run[i];
+    const uint32_t block = i < 5 ? 0 : i < 10 ? 3 : 8;
+    blocks[{block, start}] += clocks;
+    flat[start].first += clocks;
+    flat[start].second++;
+  }
+  std::string folded;
+  for (const auto& [key, clocks] : blocks) {
+    std::ostringstream line;
+    line << "block_" << std::hex << std::setfill('0') << std::setw(8)
+         << key.first << ";" << name(key.second) << " " << std::dec << clocks
+         << "\n";
+    folded += line.str();
+  }
+  std::ostringstream profiled;
+  profiler.WriteFolded(profiled);
+  EXPECT_EQ(profiled.str(), folded);
+
+  // Each instruction once, most clocks first.
+  std::stringstream flat_out;
+  profiler.WriteFlat(flat_out);
+  std::string line;
+  std::getline(flat_out, line);
+  std::ostringstream totals;
+  totals << "Clocks: " << emu.cycles()
+         << ", instructions retired: 12, not yet charged: 0";
+  EXPECT_EQ(line, totals.str());
+  std::getline(flat_out, line);  // Headings
+  std::vector<std::string> lines;
+  uint64_t last_clocks = UINT64_MAX;
+  for (; std::getline(flat_out, line);) {
+    lines.push_back(line);
+    const uint64_t clocks = std::stoull(line);
+    EXPECT_LE(clocks, last_clocks) << line;
+    last_clocks = clocks;
+  }
+  EXPECT_EQ(lines.size(), flat.size());
+  for (const auto& [start, entry] : flat) {
+    const auto& [clocks, retired] = entry;
+    std::ostringstream expected;
+    expected << std::setw(12) << clocks << std::fixed << std::setprecision(2)
+             << std::setw(8) << 100.0 * clocks / emu.cycles() << std::setw(12)
+             << retired << std::setw(14) << (double)clocks / retired << "  "
+             << name(start);
+    EXPECT_NE(std::find(lines.begin(), lines.end(), expected.str()),
+              lines.end())
+        << expected.str();
+  }
+}
@@ -8,41 +8,43 @@ RAMSim::RAMSim(size_t size,
                IData& write_data,
                IData& addr_o)
     : size_(size),
+      mask_(size - 1),
       wstrb_o_(wstrb_o),
       valid_o_(valid_o),
       ready_i_(ready_i),
       read_data_(read_data),
       write_data_(write_data),
-      addr_o_(addr_o) {
-  mem_.resize(size);
+      addr_o_(addr_o),
+      mem_(size) {
+  CHECK_EQ(size & mask_, 0u) << "RAMSim size not a power of 2";
 }
 
 void RAMSim::Do() {
-  if (valid_o_) {
-    IData* data = &mem_[addr_o_];
-    if (wstrb_o_ != 0) {
-      CData* cd = (CData*)data;
-      CData* wd = (CData*)&write_data_;
-      if (wstrb_o_ & 0x01) {
-        cd[0] = wd[0];
-      }
-      if (wstrb_o_ & 0x02) {
-        cd[1] = wd[1];
-      }
-      if (wstrb_o_ & 0x04) {
-        cd[2] = wd[2];
-      }
-      if (wstrb_o_ & 0x08) {
-        cd[3] = wd[3];
-      }
+  *ready_i_ = valid_o_;
+  // Most bus cycles carry no request, and leave read_data as it was.
+  if (!valid_o_)
+    return;
+
+  IData* data = &mem_[addr_o_ & mask_];
+  if (wstrb_o_ != 0) {
+    CData* cd = (CData*)data;
+    CData* wd = (CData*)&write_data_;
+    if (wstrb_o_ & 0x01) {
+      cd[0] = wd[0];
+    }
+    if (wstrb_o_ & 0x02) {
+      cd[1] = wd[1];
+    }
+    if (wstrb_o_ & 0x04) {
+      cd[2] = wd[2];
+    }
+    if (wstrb_o_ & 0x08) {
+      cd[3] = wd[3];
     }
-    *read_data_ = *data;
   }
-  *ready_i_ = valid_o_;
+  *read_data_ = *data;
 }
 
 void RAMSim::Randomize() {
-  for (int i = 0; i < size_; i++) {
-    mem_[i] = rand() % 255;
-  }
+  mem_.RandomizeOnTouch(rand());
 }
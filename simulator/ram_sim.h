@@ -7,8 +7,12 @@
 #include <cstdlib>
 #include <random>
 
+#include "memory_image.h"
+
 class RAMSim {
  public:
+  // size is in words, and must be a power of two: addresses wrap round it,
+  // as they do in the emulator.
   explicit RAMSim(size_t size,
                   CData& wstrb_o,
                   CData& valid_o,
@@ -17,12 +21,13 @@ class RAMSim {
                   IData& write_data,
                   IData& addr_o);
 
-  // Fill memory with garbage to simulate what real memory often looks like.
+  // Fill memory with garbage to simulate what real memory often looks like,
+  // a page at a time as it's first used.
   void Randomize();
 
   void Do();
 
-  std::vector<IData>& mem() { return mem_; }
+  MemoryImage& mem() { return mem_; }
 
  private:
   CData &wstrb_o_, &valid_o_;
@@ -32,5 +37,6 @@ class RAMSim {
   IData& addr_o_;
 
   const size_t size_;
-  std::vector<IData> mem_;
+  const size_t mask_;
+  MemoryImage mem_;
 };
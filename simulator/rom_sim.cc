@@ -6,19 +6,21 @@ ROMSim::ROMSim(size_t size,
                IData* data_o,
                IData& addr_o)
     : size_(size),
+      mask_(size - 1),
       valid_o_(valid_o),
       ready_i_(ready_i),
       data_o_(data_o),
-      addr_o_(addr_o) {
-  mem_.resize(size);
+      addr_o_(addr_o),
+      mem_(size) {
+  CHECK_EQ(size & mask_, 0u) << "ROMSim size not a power of 2";
 }
 
 void ROMSim::Do() {
-  if (valid_o_) {
-    IData* data = &mem_[addr_o_];
-    *data_o_ = *data;
-  }
   *ready_i_ = valid_o_;
+  if (valid_o_)
+    *data_o_ = mem_[addr_o_ & mask_];
 }
 
-void ROMSim::LoadHex(const std::string& filename) {}
+bool ROMSim::LoadHex(const std::string& filename) {
+  return mem_.LoadHex(filename);
+}
@@ -7,18 +7,26 @@
 #include <cstdlib>
 #include <random>
 
+#include "memory_image.h"
+
 class ROMSim {
  public:
+  // size is in words, and must be a power of two: addresses wrap round it,
+  // as they do in the emulator.
   explicit ROMSim(size_t size,
                   CData& valid_o,
                   CData* ready_i,
                   IData* data_o,
                   IData& addr_o);
 
-  void LoadHex(const std::string& filename);
+  // Load $readmemh text, as blkram's INIT_FILE, see MemoryImage::LoadHex().
+  // Returns false if it couldn't.
+  bool LoadHex(const std::string& filename);
 
   void Do();
 
+  MemoryImage& mem() { return mem_; }
+
  private:
   CData& valid_o_;
   CData* ready_i_;
@@ -26,5 +34,6 @@ class ROMSim {
   IData& addr_o_;
 
   const size_t size_;
-  std::vector<IData> mem_;
+  const size_t mask_;
+  MemoryImage mem_;
 };
@@ -0,0 +1,60 @@
+#include <absl/flags/flag.h>
+#include <absl/flags/parse.h>
+#include <glog/logging.h>
+#include <verilated.h>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+#include "Vsimtop.h"
+#include "clock_gen.h"
+#include "ram_sim.h"
+
+// Measures how many simulated simtop cycles per wall-clock second a Verilated
+// build manages. Built once per thread count the model is verilated with
+// (TTA_BENCH_THREADS), so the "bench_threads" target can compare them.
+
+ABSL_FLAG(int, cycles, 1000000, "Bus cycles to simulate");
+
+int main(int argc, char** argv) {
+  FLAGS_logtostderr = true;
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+
+  if (!std::ifstream("bootmem.mem"))
+    LOG(WARNING) << "No bootmem.mem here; simtop will just spin on an empty "
+                    "boot memory";
+
+  Verilated::commandArgs(argc, argv);
+  std::unique_ptr<Vsimtop> soc(new Vsimtop);
+  ClockGenerator generator(1, 100 /* reset_cycles */, &soc->rst_i,
+                           &soc->sysclk_i);
+  soc->rst_i = 1;
+
+  RAMSim sram(1 << 19, soc->sram_wstrb_o, soc->sram_valid_o, &soc->sram_ready_i,
+              &soc->sram_data_i, soc->sram_data_o, soc->sram_addr_o);
+
+  const int cycles = absl::GetFlag(FLAGS_cycles);
+  uint64_t retired = 0;
+  auto start = std::chrono::steady_clock::now();
+  while (!Verilated::gotFinish() && generator.cycles() < cycles) {
+    generator.Step();
+    soc->eval();
+    if (!soc->rst_i & generator.Bus()) {
+      sram.Do();
+      if (soc->instr_retired_o)
+        retired++;
+    }
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  soc->final();
+
+  std::cout << "threads=" << TTA_VERILATOR_THREADS << " cycles=" << cycles
+            << " seconds=" << elapsed.count()
+            << " cycles/s=" << cycles / elapsed.count()
+            << " instructions=" << retired << std::endl;
+  return 0;
+}
@@ -1,4 +1,14 @@
-module simtop (
+`include "common.vh"
+
+module simtop #(
+    parameter PIPELINED = 0,
+    parameter PREFETCH_DEPTH = 0,
+    parameter SCOREBOARD = 0,
+    // Bus clocks a bit, as UARTSim in simulator.cc expects.
+    parameter UART_CLKS_PER_BIT = 651,
+    // Bytes the console holds for ConsoleSim, as simulator.cc expects.
+    parameter CONSOLE_DEPTH = 64
+) (
     input wire rst_i,
     input wire sysclk_i,
 
@@ -10,13 +20,27 @@ module simtop (
     input logic sram_ready_i,
 
     input wire uart_rxd_i,
-    output wire uart_txd_o
+    output wire uart_txd_o,
+
+    // The console's buffer, for ConsoleSim to drain.
+    output wire [8*CONSOLE_DEPTH-1:0] console_data_o,
+    output wire [$clog2(CONSOLE_DEPTH+1)-1:0] console_count_o,
+    input wire console_drain_i,
+
+    // Debug visibility for the simulator's trace triggers and --profile.
+    output wire [31:0] pc_o,
+    output wire instr_done_o,
+    output wire instr_retired_o,
+    output wire [31:0] retire_start_pc_o
 );
 
     bus_if bootmem_bus;
     blkram#(
         .INIT_FILE("bootmem.mem"),
-        .RAM_DEPTH(12288)
+        .RAM_DEPTH(12288),
+        // Only the prefetch buffer keeps fetches outstanding; the sequencer
+        // holds each one until it's answered.
+        .PIPELINED(PREFETCH_DEPTH > 0)
     ) bootmem(
         .clk_i(sysclk_i),
         .rst_i(rst_i),
@@ -25,20 +49,72 @@ module simtop (
     );
 
     bus_if data_bus;
+    bus_if sram_bus;
+    bus_if io_bus;
+    bus_if uart_bus;
+    bus_if console_bus;
+    io_split io_split(
+        .cpu_bus(data_bus.slave),
+        .mem_bus(sram_bus.master),
+        .io_bus(io_bus.master)
+    );
+    io_split #(
+        .BASE(CONSOLE_DATA)
+    ) console_split(
+        .cpu_bus(io_bus.slave),
+        .mem_bus(uart_bus.master),
+        .io_bus(console_bus.master)
+    );
+
     always_comb begin
-        data_bus.read_data = sram_data_i;
-        data_bus.ready = sram_ready_i;
-        sram_data_o = data_bus.write_data;
-        sram_valid_o = data_bus.valid;
-        sram_wstrb_o = data_bus.wstrb;
-        sram_addr_o = data_bus.addr;
+        sram_bus.read_data = sram_data_i;
+        sram_bus.ready = sram_ready_i;
+        sram_bus.accept = sram_ready_i;
+        sram_data_o = sram_bus.write_data;
+        sram_valid_o = sram_bus.valid;
+        sram_wstrb_o = sram_bus.wstrb;
+        sram_addr_o = sram_bus.addr;
     end
 
-    tta tta(
+    wire uart_rx_ready;
+    wire uart_tx_empty;
+    uart #(
+        .CLKS_PER_BIT(UART_CLKS_PER_BIT)
+    ) uart(
+        .clk_i(sysclk_i),
+        .rst_i(rst_i),
+        .bus(uart_bus.slave),
+        .rxd_i(uart_rxd_i),
+        .txd_o(uart_txd_o),
+        .rx_ready_o(uart_rx_ready),
+        .tx_empty_o(uart_tx_empty)
+    );
+
+    console #(
+        .DEPTH(CONSOLE_DEPTH)
+    ) console(
+        .clk_i(sysclk_i),
+        .rst_i(rst_i),
+        .bus(console_bus.slave),
+        .data_o(console_data_o),
+        .count_o(console_count_o),
+        .drain_i(console_drain_i)
+    );
+
+    tta #(
+        .PIPELINED(PIPELINED),
+        .PREFETCH_DEPTH(PREFETCH_DEPTH),
+        .SCOREBOARD(SCOREBOARD)
+    ) tta(
         .rst_i(rst_i),
         .clk_i(sysclk_i),
         .instr_bus(bootmem_bus),
-        .data_bus(data_bus)
+        .data_bus(data_bus),
+        .irq_i({6'b0, uart_tx_empty, uart_rx_ready}),
+        .instr_done_o(instr_done_o),
+        .instr_retired_o(instr_retired_o),
+        .pc_o(pc_o),
+        .retire_start_pc_o(retire_start_pc_o)
     );
 
 endmodule : simtop
\ No newline at end of file
@@ -3,8 +3,12 @@
 #include <glog/logging.h>
 #include <verilated.h>
 #include <verilated_fst_c.h>
+#if TTA_SAVABLE
+#include <verilated_save.h>
+#endif
 
 #include <atomic>
+#include <csignal>
 #include <fstream>
 #include <iostream>
 #include <memory>
@@ -13,10 +17,122 @@
 
 #include "Vsimtop.h"
 #include "clock_gen.h"
+#include "console_sim.h"
+#include "memory_image.h"
+#include "profiler.h"
 #include "ram_sim.h"
+#include "trace_window.h"
 #include "uart_sim.h"
 
 ABSL_FLAG(std::string, trace_file, "", "Trace file");
+ABSL_FLAG(int,
+          trace_flush_interval,
+          100000,
+          "Flush the trace file every N simulation steps, or at the next "
+          "clock edge when only edges are simulated. 1 flushes on every "
+          "step (slow, but crash-safe); 0 only flushes on exit.");
+ABSL_FLAG(std::string,
+          ram_image,
+          "",
+          "Start with SRAM holding this file, host order words, mapped in "
+          "place rather than read; the file itself is never written");
+ABSL_FLAG(std::string,
+          ram_snapshot,
+          "",
+          "Write SRAM to this file on exit, in the form --ram_image takes");
+ABSL_FLAG(std::string,
+          checkpoint_file,
+          "",
+          "Checkpoint the whole simulation to this file at "
+          "--checkpoint_cycle, and exit");
+ABSL_FLAG(int, checkpoint_cycle, 0, "Bus cycle to checkpoint at");
+ABSL_FLAG(std::string,
+          restore,
+          "",
+          "Carry on from this checkpoint rather than from reset. Overrides "
+          "--ram_image");
+ABSL_FLAG(bool,
+          profile,
+          false,
+          "Count the clocks spent on each instruction, and write them to "
+          "--profile_flat and --profile_folded on exit");
+ABSL_FLAG(std::string,
+          profile_program,
+          "bootmem.mem",
+          "The program simtop was built with, for --profile's disassembly");
+ABSL_FLAG(std::string,
+          profile_flat,
+          "tta_profile.txt",
+          "Write instructions by clocks spent here");
+ABSL_FLAG(std::string,
+          profile_folded,
+          "tta_profile.folded",
+          "Write folded stacks here, for flamegraph.pl");
+
+namespace {
+std::atomic<bool> interrupted(false);
+
+// simtop's bootmem RAM_DEPTH.
+constexpr size_t kBootmemWords = 12288;
+
+// A profiler of the program in --profile_program, up to its last non-zero
+// word.
+std::unique_ptr<Profiler> ProfilerFromFlags() {
+  MemoryImage program(kBootmemWords);
+  if (!program.Load(absl::GetFlag(FLAGS_profile_program)))
+    exit(EXIT_FAILURE);
+  IData* end = program.end();
+  while (end != program.begin() && end[-1] == 0)
+    end--;
+  return std::make_unique<Profiler>(
+      std::vector<uint32_t>(program.begin(), end));
+}
+
+#if TTA_SAVABLE
+// A checkpoint is the model, then the clock, SRAM, the UART and the
+// console, in that order. They can only be restored into the same build of
+// tta_sim.
+void SaveCheckpoint(const std::string& filename,
+                    Vsimtop* soc,
+                    const ClockGenerator& generator,
+                    RAMSim& sram,
+                    const UARTSim& uart,
+                    const ConsoleSim& console) {
+  VerilatedSave os;
+  os.open(filename.c_str());
+  if (!os.isOpen())
+    LOG(FATAL) << "Can't write checkpoint " << filename;
+  os << *soc;
+  generator.Save(os);
+  sram.mem().Save(os);
+  uart.Save(os);
+  console.Save(os);
+  os.close();
+  LOG(INFO) << "Checkpointed cycle " << generator.cycles() << " to "
+            << filename;
+}
+
+void RestoreCheckpoint(const std::string& filename,
+                       Vsimtop* soc,
+                       ClockGenerator* generator,
+                       RAMSim* sram,
+                       UARTSim* uart,
+                       ConsoleSim* console) {
+  VerilatedRestore is;
+  is.open(filename.c_str());
+  if (!is.isOpen())
+    LOG(FATAL) << "Can't read checkpoint " << filename;
+  is >> *soc;
+  generator->Restore(is);
+  sram->mem().Restore(is);
+  uart->Restore(is);
+  console->Restore(is);
+  is.close();
+  LOG(INFO) << "Restored cycle " << generator->cycles() << " from "
+            << filename;
+}
+#endif
+}  // namespace
 
 int main(int argc, char** argv) {
   FLAGS_logtostderr = true;
@@ -33,29 +149,94 @@ int main(int argc, char** argv) {
     Verilated::traceEverOn(true);
     soc->trace(&trace, 99);
     trace.open(absl::GetFlag(FLAGS_trace_file).c_str());
+    generator.set_trace_flush_interval(
+        absl::GetFlag(FLAGS_trace_flush_interval));
     LOG(INFO) << "Opened trace file: " << absl::GetFlag(FLAGS_trace_file);
   }
 
+  // Buffered trace data only reaches the file on flush/close, so make sure
+  // Ctrl-C still ends with a usable trace.
+  std::signal(SIGINT, [](int) { interrupted = true; });
+
+  TraceWindow window = TraceWindow::FromFlags();
+  std::unique_ptr<Profiler> profiler;
+  if (absl::GetFlag(FLAGS_profile))
+    profiler = ProfilerFromFlags();
+
   soc->rst_i = 1;
+  soc->uart_rxd_i = 1;  // Idle
 
   UARTSim s(std::cout);
+  ConsoleSim console(std::cout);
+  static_assert(sizeof(soc->console_data_o) == ConsoleSim::kDepth,
+                "simtop's CONSOLE_DEPTH doesn't match ConsoleSim");
 
   RAMSim sram(1 << 19, soc->sram_wstrb_o, soc->sram_valid_o, &soc->sram_ready_i,
-              &soc->sram_data_o, soc->sram_data_i, soc->sram_addr_o);
-  while (!Verilated::gotFinish()) {
-    generator.Step(&trace);
+              &soc->sram_data_i, soc->sram_data_o, soc->sram_addr_o);
+  if (!absl::GetFlag(FLAGS_ram_image).empty() &&
+      !sram.mem().Map(absl::GetFlag(FLAGS_ram_image)))
+    exit(EXIT_FAILURE);
+
+  const std::string checkpoint = absl::GetFlag(FLAGS_checkpoint_file);
+  const int checkpoint_cycle = absl::GetFlag(FLAGS_checkpoint_cycle);
+#if TTA_SAVABLE
+  if (!absl::GetFlag(FLAGS_restore).empty())
+    RestoreCheckpoint(absl::GetFlag(FLAGS_restore), soc.get(), &generator,
+                      &sram, &s, &console);
+#else
+  if (!checkpoint.empty() || !absl::GetFlag(FLAGS_restore).empty())
+    LOG(FATAL) << "Checkpoints need simtop verilated with --savable; "
+                  "configure with -DTTA_SAVABLE=ON";
+#endif
+  bool checkpointed = false;
+  while (!Verilated::gotFinish() && !interrupted) {
+    generator.Edge(trace.isOpen() && window.tracing() ? &trace : nullptr);
 
     soc->eval();
 
     if (!soc->rst_i & generator.Bus()) {
       sram.Do();
-      static int baud_count = 0;
-      if (baud_count == 651) {
-        s.Push(soc->uart_txd_o);
-        baud_count = 0;
+
+      // The boot memory bus is internal to simtop, so only the data side is
+      // visible here.
+      TraceWindow::Cycle c = {};
+      c.cycle = generator.cycles();
+      c.pc = soc->pc_o;
+      c.data_valid = soc->sram_valid_o;
+      c.data_wstrb = soc->sram_wstrb_o;
+      c.data_addr = soc->sram_addr_o;
+      c.data_write = soc->sram_data_o;
+      c.data_read = soc->sram_data_i;
+      window.Sample(c);
+      if (profiler)
+        profiler->Clock(soc->instr_retired_o, soc->retire_start_pc_o);
+
+      s.Clock(soc->uart_txd_o, &soc->uart_rxd_i);
+      console.Clock(soc->console_data_o, soc->console_count_o,
+                    &soc->console_drain_i);
+
+#if TTA_SAVABLE
+      if (!checkpoint.empty() && generator.cycles() == checkpoint_cycle) {
+        SaveCheckpoint(checkpoint, soc.get(), generator, sram, s, console);
+        checkpointed = true;
+        break;
       }
-      baud_count++;
+#endif
     }
   }
+  // What a checkpoint leaves in the console comes out of the run restored
+  // from it.
+  if (!checkpointed)
+    console.Flush(soc->console_data_o, soc->console_count_o);
+  if (trace.isOpen())
+    trace.close();
+  if (interrupted)
+    window.DumpHistory(std::cerr);
+  if (profiler && !profiler->WriteFiles(absl::GetFlag(FLAGS_profile_flat),
+                                        absl::GetFlag(FLAGS_profile_folded)))
+    exit(EXIT_FAILURE);
+  if (!absl::GetFlag(FLAGS_ram_snapshot).empty() &&
+      !sram.mem().Snapshot(absl::GetFlag(FLAGS_ram_snapshot)))
+    exit(EXIT_FAILURE);
   exit(EXIT_SUCCESS);
 }
\ No newline at end of file
@@ -0,0 +1,344 @@
+#include "test_programs.h"
+
+TestProgram PerfCountersProgram() {
+  TestProgram t;
+  t.program = {Instr()
+                   .Src(Unit::UNIT_ABS_OPERAND)
+                   .Soperand(123)
+                   .Dst(Unit::UNIT_ALU_LEFT)
+                   .Di(0),
+               Instr()
+                   .Src(Unit::UNIT_ABS_IMMEDIATE)
+                   .Si((int)ALUOp::ALU_ADD)
+                   .Dst(Unit::UNIT_ALU_OPERATOR)
+                   .Di(0),
+               Instr()
+                   .Src(Unit::UNIT_ALU_RESULT)
+                   .Si(0)
+                   .Dst(Unit::UNIT_REGISTER)
+                   .Di(0),
+               Instr()
+                   .Src(Unit::UNIT_CONTROL)
+                   .Si((int)ControlReg::CTRL_PERF_INSTRET)
+                   .Dst(Unit::UNIT_MEMORY_IMMEDIATE)
+                   .Di(200),
+               Instr()
+                   .Src(Unit::UNIT_CONTROL)
+                   .Si((int)ControlReg::CTRL_PERF_OPERAND_FETCHES)
+                   .Dst(Unit::UNIT_MEMORY_IMMEDIATE)
+                   .Di(201),
+               Instr()
+                   .Src(Unit::UNIT_CONTROL)
+                   .Si((int)ControlReg::CTRL_PERF_ALU_READS)
+                   .Dst(Unit::UNIT_MEMORY_IMMEDIATE)
+                   .Di(202),
+               Instr()
+                   .Src(Unit::UNIT_CONTROL)
+                   .Si((int)ControlReg::CTRL_PERF_CYCLES)
+                   .Dst(Unit::UNIT_MEMORY_IMMEDIATE)
+                   .Di(203),
+               Instr()
+                   .Src(Unit::UNIT_ABS_IMMEDIATE)
+                   .Si(0)
+                   .Dst(Unit::UNIT_CONTROL)
+                   .Di((int)ControlReg::CTRL_PERF_INSTRET),
+               Instr()
+                   .Src(Unit::UNIT_CONTROL)
+                   .Si((int)ControlReg::CTRL_PERF_INSTRET)
+                   .Dst(Unit::UNIT_MEMORY_IMMEDIATE)
+                   .Di(204)};
+  t.retired = 9;
+  t.results = {
+      {200, 3},  // instructions before the read
+      {201, 1},
+      {202, 1},
+      {204, 0},  // cleared, and the clear itself isn't counted
+  };
+  return t;
+}
+
+TestProgram StackProgram() {
+  TestProgram t;
+  t.program = {Instr().Src(Unit::UNIT_ABS_IMMEDIATE).Si(1).Push(),
+               Instr().Src(Unit::UNIT_ABS_IMMEDIATE).Si(2).Push(),
+               Instr().Src(Unit::UNIT_ABS_IMMEDIATE).Si(3).Push(),
+               Instr().Peek(2).Dst(Unit::UNIT_MEMORY_IMMEDIATE).Di(100),
+               Instr().Src(Unit::UNIT_ABS_IMMEDIATE).Si(20).Poke(1),
+               Instr().Pop().Dst(Unit::UNIT_REGISTER).Di(1),
+               Instr().Pop().Dst(Unit::UNIT_MEMORY_IMMEDIATE).Di(101),
+               Instr().Pop().Push(),
+               Instr().Pop().Dst(Unit::UNIT_REGISTER).Di(2)};
+  t.retired = 9;
+  t.regs = {{1, 3}, {2, 1}};
+  t.results = {{100, 1}, {101, 20}};
+  return t;
+}
+
+TestProgram SubWordAccessProgram() {
+  TestProgram t;
+  t.program = {
+      Instr().Src(Unit::UNIT_ABS_IMMEDIATE).Si(200).Dst(Unit::UNIT_REGISTER).Di(1),
+      Instr()
+          .Src(Unit::UNIT_REGISTER_POINTER)
+          .Si(1)
+          .SrcWidth(MemWidth::MEM_BYTE)
+          .Dst(Unit::UNIT_REGISTER)
+          .Di(2),
+      Instr()
+          .Src(Unit::UNIT_MEMORY_OPERAND)
+          .SrcWidth(MemWidth::MEM_BYTE_SIGNED)
+          .Soperand(201)
+          .Dst(Unit::UNIT_REGISTER)
+          .Di(3),
+      Instr()
+          .Src(Unit::UNIT_MEMORY_OPERAND)
+          .SrcWidth(MemWidth::MEM_HALF)
+          .Soperand(202)
+          .Dst(Unit::UNIT_REGISTER)
+          .Di(4),
+      Instr()
+          .Src(Unit::UNIT_REGISTER_POINTER)
+          .Si(1)
+          .SrcWidth(MemWidth::MEM_HALF_SIGNED)
+          .Dst(Unit::UNIT_REGISTER)
+          .Di(5),
+      Instr()
+          .Src(Unit::UNIT_REGISTER)
+          .Si(2)
+          .Dst(Unit::UNIT_MEMORY_OPERAND)
+          .DstWidth(MemWidth::MEM_BYTE)
+          .Doperand(4 * 124 + 1),
+      Instr()
+          .Src(Unit::UNIT_REGISTER)
+          .Si(5)
+          .Dst(Unit::UNIT_MEMORY_OPERAND)
+          .DstWidth(MemWidth::MEM_HALF)
+          .Doperand(4 * 125 + 2)};
+  t.retired = 7;
+  t.memory = {{50, 0x8081f2f3}};
+  t.regs = {{2, 0xf3}, {3, 0xfffffff2}, {4, 0x8081}, {5, 0xfffff2f3}};
+  t.results = {{124, 0x0000f300}, {125, 0xf2f30000}};
+  return t;
+}
+
+TestProgram PointerUpdateProgram() {
+  TestProgram t;
+  t.program = {
+      Instr().Src(Unit::UNIT_ABS_IMMEDIATE).Si(100).Dst(Unit::UNIT_REGISTER).Di(1),
+      Instr().Src(Unit::UNIT_ABS_IMMEDIATE).Si(200).Dst(Unit::UNIT_REGISTER).Di(2)};
+  for (int i = 0; i < 4; i++) {
+    t.program.push_back(Instr()
+                            .Src(Unit::UNIT_REGISTER_POINTER)
+                            .Si(1)
+                            .SrcPtr(PtrMode::PTR_POST_INC)
+                            .Dst(Unit::UNIT_REGISTER_POINTER)
+                            .Di(2)
+                            .DstPtr(PtrMode::PTR_POST_INC));
+  }
+  t.program.push_back(Instr()
+                          .Src(Unit::UNIT_REGISTER_POINTER)
+                          .Si(1)
+                          .SrcPtr(PtrMode::PTR_PRE_DEC)
+                          .Dst(Unit::UNIT_REGISTER)
+                          .Di(3));
+  t.program.push_back(Instr()
+                          .Src(Unit::UNIT_ABS_IMMEDIATE)
+                          .Si(7)
+                          .Dst(Unit::UNIT_REGISTER_POINTER)
+                          .Di(2)
+                          .DstPtr(PtrMode::PTR_PRE_DEC));
+  t.program.push_back(Instr()
+                          .Src(Unit::UNIT_ABS_IMMEDIATE)
+                          .Si(5)
+                          .Dst(Unit::UNIT_REGISTER_POINTER)
+                          .Di(3));
+  t.retired = 9;
+  for (int i = 0; i < 4; i++)
+    t.memory[100 + i] = 11 * (i + 1);
+  t.regs = {{1, 103}, {2, 203}, {3, 44}};
+  t.results = {{200, 11}, {201, 22}, {202, 33}, {203, 7}, {44, 5}};
+  return t;
+}
+
+TestProgram MultiCycleAluProgram() {
+  TestProgram t;
+  Program& program = t.program;
+  auto set_alu = [&program](int alu, int left, int right, ALUOp op) {
+    program.push_back(Instr()
+                          .Src(Unit::UNIT_ABS_IMMEDIATE)
+                          .Si(left)
+                          .Dst(Unit::UNIT_ALU_LEFT)
+                          .Di(alu));
+    program.push_back(Instr()
+                          .Src(Unit::UNIT_ABS_IMMEDIATE)
+                          .Si(right)
+                          .Dst(Unit::UNIT_ALU_RIGHT)
+                          .Di(alu));
+    program.push_back(Instr()
+                          .Src(Unit::UNIT_ABS_IMMEDIATE)
+                          .Si((int)op)
+                          .Dst(Unit::UNIT_ALU_OPERATOR)
+                          .Di(alu));
+  };
+  auto read = [&program](Unit src, int si, int reg) {
+    program.push_back(Instr().Src(src).Si(si).Dst(Unit::UNIT_REGISTER).Di(reg));
+  };
+  set_alu(0, 1000, 7, ALUOp::ALU_DIV);
+  set_alu(1, 1000, 7, ALUOp::ALU_MOD);
+  set_alu(2, 1000, 7, ALUOp::ALU_MUL);
+  read(Unit::UNIT_CONTROL, (int)ControlReg::CTRL_ALU_BUSY, 0);
+  read(Unit::UNIT_ALU_RESULT, 0, 1);
+  read(Unit::UNIT_ALU_RESULT, 1, 2);
+  read(Unit::UNIT_ALU_RESULT, 2, 3);
+  read(Unit::UNIT_CONTROL, (int)ControlReg::CTRL_ALU_BUSY, 4);
+  set_alu(3, 5, 0, ALUOp::ALU_DIV);
+  read(Unit::UNIT_ALU_RESULT, 3, 5);
+  t.retired = program.size();
+  t.wait_clocks = 3 * 32;
+  t.regs = {
+      {0, 0x7},  // all three still working
+      {1, 142},
+      {2, 6},
+      {3, 7000},
+      {4, 0},
+      {5, 0},  // divide by zero
+  };
+  return t;
+}
+
+TestProgram ScoreboardProgram() {
+  TestProgram t;
+  t.program = {
+      Instr().Src(Unit::UNIT_ABS_IMMEDIATE).Si(1000).Dst(Unit::UNIT_ALU_LEFT).Di(0),
+      Instr().Src(Unit::UNIT_ABS_IMMEDIATE).Si(7).Dst(Unit::UNIT_ALU_RIGHT).Di(0),
+      Instr()
+          .Src(Unit::UNIT_ABS_IMMEDIATE)
+          .Si((int)ALUOp::ALU_DIV)
+          .Dst(Unit::UNIT_ALU_OPERATOR)
+          .Di(0),
+      Instr().Src(Unit::UNIT_ALU_RESULT).Si(0).Dst(Unit::UNIT_REGISTER).Di(1),
+      Instr().Src(Unit::UNIT_ABS_IMMEDIATE).Si(5).Dst(Unit::UNIT_REGISTER).Di(2),
+      Instr()
+          .Src(Unit::UNIT_ABS_IMMEDIATE)
+          .Si(6)
+          .Dst(Unit::UNIT_MEMORY_IMMEDIATE)
+          .Di(100),
+      Instr().Src(Unit::UNIT_REGISTER).Si(1).Dst(Unit::UNIT_REGISTER).Di(3)};
+  t.retired = 7;
+  t.wait_clocks = 32;
+  t.regs = {{1, 142}, {2, 5}, {3, 142}};
+  t.results = {{100, 6}};
+  return t;
+}
+
+TestProgram BundleProgram() {
+  auto move = [](Unit src, int si, Unit dst, int di) {
+    return Instr().Src(src).Si(si).Dst(dst).Di(di);
+  };
+  const Unit kImm = Unit::UNIT_ABS_IMMEDIATE;
+  const Unit kReg = Unit::UNIT_REGISTER;
+  TestProgram t;
+  t.program = {
+      move(kImm, 3, kReg, 1).Pair(move(kImm, 4, kReg, 2)),
+      move(kReg, 1, Unit::UNIT_ALU_LEFT, 0)
+          .Pair(move(kReg, 2, Unit::UNIT_ALU_RIGHT, 0)),
+      move(kImm, (int)ALUOp::ALU_ADD, Unit::UNIT_ALU_OPERATOR, 0),
+      move(Unit::UNIT_ALU_RESULT, 0, kReg, 3),
+      // Both read before either writes.
+      move(kReg, 2, kReg, 1).Pair(move(kReg, 1, kReg, 2)),
+      move(kReg, 3, Unit::UNIT_MEMORY_IMMEDIATE, 100)
+          .Pair(move(kImm, 9, kReg, 4)),
+      // The bundled move's write wins.
+      move(kImm, 1, kReg, 5).Pair(move(kImm, 2, kReg, 5)),
+  };
+  t.retired = t.program.size();
+  t.regs = {{1, 4}, {2, 3}, {3, 7}, {4, 9}, {5, 2}};
+  t.results = {{100, 7}};
+  return t;
+}
+
+TestProgram GuardProgram() {
+  auto move = [](Unit src, int si, Unit dst, int di) {
+    return Instr().Src(src).Si(si).Dst(dst).Di(di);
+  };
+  const Unit kImm = Unit::UNIT_ABS_IMMEDIATE;
+  const Unit kReg = Unit::UNIT_REGISTER;
+  const Unit kResult = Unit::UNIT_ALU_RESULT;
+  TestProgram t;
+  t.program = {
+      move(kImm, 0, kReg, 1).Pair(move(kImm, 5, kReg, 2)),
+      move(kImm, 1, kReg, 3).If(kReg, 1),
+      move(kImm, 1, kReg, 4).IfNot(kReg, 1),
+      move(kImm, 7, kReg, 5).Pair(move(kImm, 8, kReg, 6)).If(kReg, 2),
+      // Takes the bundled move with it.
+      move(kImm, 7, kReg, 7).Pair(move(kImm, 8, kReg, 8)).If(kReg, 1),
+      move(kImm, 3, Unit::UNIT_ALU_LEFT, 0)
+          .Pair(move(kImm, 3, Unit::UNIT_ALU_RIGHT, 0)),
+      move(kImm, (int)ALUOp::ALU_EQL, Unit::UNIT_ALU_OPERATOR, 0),
+      move(kImm, 9, Unit::UNIT_MEMORY_IMMEDIATE, 100).If(kResult, 0),
+      // A squashed branch falls through.
+      move(kImm, 0, Unit::UNIT_PC, 0).IfNot(kResult, 0),
+      move(kImm, 1, kReg, 9),
+      // Waits for the multiply.
+      move(kImm, 2, Unit::UNIT_ALU_LEFT, 1)
+          .Pair(move(kImm, 3, Unit::UNIT_ALU_RIGHT, 1)),
+      move(kImm, (int)ALUOp::ALU_MUL, Unit::UNIT_ALU_OPERATOR, 1),
+      move(kResult, 1, kReg, 10).If(kResult, 1),
+  };
+  t.retired = t.program.size();
+  t.wait_clocks = 8;
+  t.regs = {{3, 0}, {4, 1}, {5, 7}, {6, 8}, {7, 0}, {8, 0}, {9, 1}, {10, 6}};
+  t.results = {{100, 9}};
+  return t;
+}
+
+TestProgram LoopProgram() {
+  auto move = [](Unit src, int si, Unit dst, int di) {
+    return Instr().Src(src).Si(si).Dst(dst).Di(di);
+  };
+  const Unit kImm = Unit::UNIT_ABS_IMMEDIATE;
+  const Unit kCtrl = Unit::UNIT_CONTROL;
+  TestProgram t;
+  t.program = {
+      move(kImm, 0, Unit::UNIT_ALU_LEFT, 0)
+          .Pair(move(kImm, 3, Unit::UNIT_ALU_RIGHT, 0)),  // 0, 1
+      move(kImm, (int)ALUOp::ALU_ADD, Unit::UNIT_ALU_OPERATOR, 0),
+      move(kImm, 6, kCtrl, (int)ControlReg::CTRL_LOOP_START),
+      move(kImm, 8, kCtrl, (int)ControlReg::CTRL_LOOP_END),
+      move(kImm, 4, kCtrl, (int)ControlReg::CTRL_LOOP_COUNT),
+      move(Unit::UNIT_ALU_RESULT, 0, Unit::UNIT_ALU_LEFT, 0),  // 6
+      move(kCtrl, (int)ControlReg::CTRL_LOOP_COUNT, Unit::UNIT_REGISTER, 2),
+      move(Unit::UNIT_ALU_LEFT, 0, Unit::UNIT_REGISTER, 1),  // 8
+  };
+  t.retired = 5 + 4 * 2 + 1;
+  t.regs = {{1, 12}, {2, 0}};
+  return t;
+}
+
+TestProgram ConsoleProgram(int bytes) {
+  const uint32_t kData = (uint32_t)ConsoleReg::CONSOLE_DATA;
+  TestProgram t;
+  for (int i = 0; i < bytes; i++)
+    t.program.push_back(Instr()
+                            .Src(Unit::UNIT_ABS_IMMEDIATE)
+                            .Si('a' + i)
+                            .Dst(Unit::UNIT_MEMORY_OPERAND)
+                            .Doperand(kData));
+  t.program.push_back(Instr()
+                          .Src(Unit::UNIT_MEMORY_OPERAND)
+                          .Soperand(kData)
+                          .Dst(Unit::UNIT_REGISTER)
+                          .Di(1));
+  const uint32_t halt = Instr::Size(t.program);
+  t.program.push_back(
+      Instr().Src(Unit::UNIT_ABS_IMMEDIATE).Si(halt).Dst(Unit::UNIT_PC));
+  t.retired = bytes + 1;
+  return t;
+}
+
+std::string ConsoleBytes(int bytes) {
+  std::string s;
+  for (int i = 0; i < bytes; i++)
+    s.push_back('a' + i);
+  return s;
+}
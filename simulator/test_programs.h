@@ -0,0 +1,64 @@
+#pragma once
+
+#include <verilated.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "assembler.h"
+
+// Programs which tta_test runs against the RTL and tta_emulator_test against
+// the emulator, with what each should leave behind, so the two check the
+// same thing.
+struct TestProgram {
+  Program program;
+  // Instructions it retires.
+  int retired = 0;
+  // Clocks it may wait on the ALUs beyond that, on top of the RTL tests'
+  // allowance per instruction.
+  int wait_clocks = 0;
+  // Data memory words set once reset is released, by word address.
+  std::map<uint32_t, IData> memory;
+  // The registers, and data memory words, it should leave.
+  std::map<int, IData> regs;
+  std::map<uint32_t, IData> results;
+};
+
+// Reads the performance counters, and clears one. Whether cycles were
+// counted is left to the test, as the RTL and emulator count differently.
+TestProgram PerfCountersProgram();
+
+// Pushes, pops, peeks and pokes.
+TestProgram StackProgram();
+
+// Byte and halfword loads and stores, signed and not.
+TestProgram SubWordAccessProgram();
+
+// Copies through pointers which step themselves, then stores through one.
+TestProgram PointerUpdateProgram();
+
+// Multiplies, divides and takes a remainder, reading CTRL_ALU_BUSY while
+// they work, then divides by zero.
+TestProgram MultiCycleAluProgram();
+
+// Starts a divide and reads it, with independent moves after the read
+// which the scoreboard lets go first.
+TestProgram ScoreboardProgram();
+
+// Bundles of two moves, reading before either writes.
+TestProgram BundleProgram();
+
+// Moves guarded on registers and ALU results, bundles and a branch among
+// them.
+TestProgram GuardProgram();
+
+// Adds 3 four times round a hardware loop, noting the count as it goes.
+TestProgram LoopProgram();
+
+// Writes that many bytes, from 'a' up, to the console, then reads its count
+// into R01 and halts in a jump to itself. retired covers the read; what it reads
+// depends on how the console has been drained, so is left to the test.
+TestProgram ConsoleProgram(int bytes);
+// What it writes.
+std::string ConsoleBytes(int bytes);
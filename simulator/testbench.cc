@@ -0,0 +1,224 @@
+#include "testbench.h"
+
+#include <glog/logging.h>
+#include <verilated_fst_c.h>
+
+#include <algorithm>
+#include <sstream>
+
+// Set when testtop is built with INSTR_BLKRAM.
+#ifndef TTA_INSTR_BLKRAM
+#define TTA_INSTR_BLKRAM 0
+#endif
+#if TTA_INSTR_BLKRAM
+#include "Vtesttop___024root.h"
+#endif
+
+TestBench::TestBench()
+    : context_(std::make_unique<VerilatedContext>()),
+      top_(std::make_unique<Vtesttop>(context_.get())),
+      clock_gen_(1, 1 /* reset_cycles */, &top_->rst_i, &top_->sysclk_i),
+      prg_(kMemorySize,
+           c_gnd_,
+           top_->instr_valid_o,
+           &top_->instr_ready_i,
+           &top_->instr_data_read_i,
+           i_gnd_,
+           top_->instr_addr_o),
+      ram_(kMemorySize,
+           top_->data_wstrb_o,
+           top_->data_valid_o,
+           &top_->data_ready_i,
+           &top_->data_data_read_i,
+           top_->data_data_write_o,
+           top_->data_addr_o),
+      window_(TraceWindow::FromFlags()),
+      uart_(uart_out_, kUartClocksPerBit) {
+  top_->uart_rxd_i = 1;  // Idle
+  static_assert(sizeof(top_->console_data_o) == kConsoleDepth,
+                "kConsoleDepth doesn't match testtop's CONSOLE_DEPTH");
+  SetConsoleDrain(kConsoleDrainInterval);
+}
+
+TestBench::~TestBench() {
+  CloseTrace();
+}
+
+void TestBench::Step() {
+  clock_gen_.Step(window_.tracing() ? trace_.get() : nullptr);
+  top_->eval();
+  if (!top_->rst_i & clock_gen_.Bus()) {
+    ram_.Do();
+    prg_.Do();
+    uart_.Clock(top_->uart_txd_o, &top_->uart_rxd_i);
+    // Held, it sees an empty console, so still ends a drain under way.
+    console_->Clock(top_->console_data_o,
+                    console_held_ ? 0 : top_->console_count_o,
+                    &top_->console_drain_i);
+
+    TraceWindow::Cycle c = {};
+    c.cycle = clock_gen_.cycles();
+    c.pc = top_->pc_o;
+    c.instr_valid = top_->instr_valid_o;
+    c.instr_addr = top_->instr_addr_o;
+    c.instr_data = top_->instr_data_read_i;
+    c.data_valid = top_->data_valid_o;
+    c.data_wstrb = top_->data_wstrb_o;
+    c.data_addr = top_->data_addr_o;
+    c.data_write = top_->data_data_write_o;
+    c.data_read = top_->data_data_read_i;
+    window_.Sample(c);
+
+    const bool retired = top_->instr_retired_o;
+    if (retired)
+      retired_++;
+    if (emu_)
+      Lockstep(retired);
+  }
+}
+
+int TestBench::RunUntil(int max_clocks) {
+  int start_clk = clock_gen_.cycles();
+  while (!context_->gotFinish() &&
+         (clock_gen_.cycles() < max_clocks + start_clk)) {
+    Step();
+  }
+  return clock_gen_.cycles() - start_clk;
+}
+
+int TestBench::RunInstructions(int n, int max_clocks) {
+  int start_clk = clock_gen_.cycles();
+  int start_retired = retired_;
+  while (!context_->gotFinish() && retired_ - start_retired < n &&
+         clock_gen_.cycles() < max_clocks + start_clk) {
+    Step();
+  }
+  return retired_ - start_retired;
+}
+
+void TestBench::Load(const Program& program, uint32_t addr) {
+  const size_t words = Instr::Size(program);
+  size_t n = words;
+  IData* code = prg_.mem().Span(addr, &n);
+  CHECK_EQ(n, words) << "Program doesn't fit at " << addr;
+  Instr::Assemble(program, code, n);
+  LoadInstrRam();
+}
+
+void TestBench::LoadInstrRam() {
+#if TTA_INSTR_BLKRAM
+  auto& bram = top_->rootp->testtop__DOT__instr_ram__DOT__ram__DOT__bram_reg;
+  static_assert(sizeof(bram) == kMemorySize * sizeof(IData),
+                "testtop's instruction blkram isn't kMemorySize words");
+  for (size_t i = 0; i < kMemorySize; i++)
+    bram[i] = prg_.mem()[i];
+#endif
+}
+
+void TestBench::SetConsoleDrain(int drain_interval) {
+  console_ =
+      std::make_unique<ConsoleSim>(console_out_, kConsoleDepth, drain_interval);
+  top_->console_drain_i = 0;
+}
+
+bool TestBench::LoadFile(const std::string& filename) {
+  if (!prg_.mem().Load(filename))
+    return false;
+  LoadInstrRam();
+  return true;
+}
+
+void TestBench::EnableLockstep() {
+  emu_ram_.resize(ram_.mem().size());
+  emu_ = std::make_unique<Emulator>(prg_.mem().data(), prg_.mem().size(),
+                                    emu_ram_.data(), emu_ram_.size());
+}
+
+void TestBench::OpenTrace(const std::string& filename) {
+  context_->traceEverOn(true);
+  trace_ = std::make_unique<VerilatedFstC>();
+  top_->trace(trace_.get(), 99);
+  trace_->open(filename.c_str());
+}
+
+void TestBench::CloseTrace() {
+  if (trace_) {
+    trace_->flush();
+    trace_->close();
+    trace_.reset();
+  }
+}
+
+void TestBench::Lockstep(bool retired) {
+  if (!emu_synced_) {
+    // Tests set up memory between reset and the first instruction.
+    std::copy(ram_.mem().begin(), ram_.mem().end(), emu_ram_.begin());
+    emu_->Reset();
+    emu_synced_ = true;
+  }
+  const size_t ram_mask = ram_.mem().size() - 1;
+  if (top_->data_valid_o && top_->data_wstrb_o)
+    rtl_stores_.insert(top_->data_addr_o & ram_mask);
+
+  if (retired) {
+    rtl_starts_.insert(top_->retire_start_pc_o);
+    lockstep_pc_ = emu_->pc();
+    emu_starts_.insert(lockstep_pc_);
+    lockstep_instr_ = Instr::Disassemble(&prg_.mem()[lockstep_pc_]).ToString();
+    emu_->Step();
+    read_device_ |= emu_->read_device();
+    if (const auto& store = emu_->last_store())
+      emu_stores_.insert(store->addr & ram_mask);
+    check_pending_ = true;
+    return;
+  }
+
+  // Register writes may land on the clock after retirement, so compare one
+  // clock later. Instructions which retire back to back are checked
+  // together, once the last of them has, as are any which retired ahead of
+  // an ALU read the scoreboard held back.
+  if (check_pending_ && !divergence_ && !top_->instr_pending_o) {
+    if (read_device_) {
+      LOG(INFO) << "Lockstep ends at a device read, after instruction "
+                << emu_->instructions() << " at " << lockstep_pc_ << " ("
+                << lockstep_instr_ << ")";
+      emu_.reset();
+      return;
+    }
+    std::ostringstream diffs;
+    if (top_->pc_o != emu_->pc())
+      diffs << " pc=" << top_->pc_o << " (expected " << emu_->pc() << ")";
+    for (int r = 0; r < Emulator::kNumRegisters; r++) {
+      if (top_->regs_o[r] != emu_->reg(r))
+        diffs << " r" << r << "=" << top_->regs_o[r] << " (expected "
+              << emu_->reg(r) << ")";
+    }
+    rtl_stores_.insert(emu_stores_.begin(), emu_stores_.end());
+    for (IData addr : rtl_stores_) {
+      if (ram_.mem()[addr] != emu_ram_[addr])
+        diffs << " mem[" << addr << "]=" << ram_.mem()[addr] << " (expected "
+              << emu_ram_[addr] << ")";
+    }
+    rtl_stores_.clear();
+    emu_stores_.clear();
+    if (rtl_starts_ != emu_starts_) {
+      diffs << " retired from";
+      for (IData start : rtl_starts_)
+        diffs << " " << start;
+      diffs << " (expected";
+      for (IData start : emu_starts_)
+        diffs << " " << start;
+      diffs << ")";
+    }
+    rtl_starts_.clear();
+    emu_starts_.clear();
+    if (!diffs.str().empty()) {
+      std::ostringstream msg;
+      msg << "RTL diverged from emulator after instruction "
+          << emu_->instructions() << " at " << lockstep_pc_ << " ("
+          << lockstep_instr_ << "):" << diffs.str();
+      divergence_ = msg.str();
+    }
+    check_pending_ = false;
+  }
+}
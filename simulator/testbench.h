@@ -0,0 +1,162 @@
+#pragma once
+
+#include <verilated.h>
+
+#include <memory>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Vtesttop.h"
+#include "assembler.h"
+#include "clock_gen.h"
+#include "console_sim.h"
+#include "emulator.h"
+#include "ram_sim.h"
+#include "trace_window.h"
+#include "uart_sim.h"
+
+class VerilatedFstC;
+
+// A Vtesttop with program and data memories attached, and helpers to load
+// programs into it and run them. Shared by the tests and benchmarks.
+//
+// Each has a VerilatedContext of its own, so separate TestBenches can run on
+// separate threads; see batch.h.
+class TestBench {
+ public:
+  static constexpr size_t kMemorySize = 1024;
+  // testtop's UART_CLKS_PER_BIT.
+  static constexpr int kUartClocksPerBit = 16;
+  // testtop's CONSOLE_DEPTH, and how long a byte waits there by default.
+  static constexpr int kConsoleDepth = 12;
+  static constexpr int kConsoleDrainInterval = 64;
+
+  TestBench();
+  ~TestBench();
+
+  TestBench(TestBench&) = delete;
+
+  void Reset() { top_->rst_i = 1; }
+
+  void Step();
+
+  /*
+   * Run until "pin" equals "val" or max_clocks has been reached.
+   * Returns true if the pin reached the intended value before the clock ran
+   * out.
+   */
+  template <typename T>
+  bool RunUntil(T* pin, T val, int max_clocks) {
+    int start_clocks = clock_gen_.cycles();
+    while (!context_->gotFinish()) {
+      Step();
+
+      if (*pin == val || clock_gen_.cycles())
+        return true;
+      else if (clock_gen_.cycles() - start_clocks >= max_clocks)
+        return false;
+    }
+    return false;
+  }
+
+  /**
+   * Run until max_clocks cycles have executed.
+   */
+  int RunUntil(int max_clocks);
+
+  /**
+   * Run until n instructions have retired, or max_clocks cycles have
+   * executed. Returns the number of instructions retired.
+   */
+  int RunInstructions(int n, int max_clocks);
+
+  // Built with TTA_INSTR_BLKRAM, against a testtop fetching from its own
+  // blkram, these copy the whole of prg() there too. Writes to prg() after
+  // that only reach the emulator.
+  void Load(const Program& program, uint32_t addr = 0);
+  // Load a program image of any kind MemoryImage::Load() takes. Returns
+  // false if it couldn't.
+  bool LoadFile(const std::string& filename);
+
+  /*
+   * Run the functional emulator in lockstep with the RTL from when reset is
+   * released. Each time an instruction retires, the PC, the registers and
+   * any memory written are compared against it, and where the instructions
+   * retired start against retire_start_pc_o. The first divergence is
+   * recorded in divergence(). The emulator doesn't see the RTL's interrupt
+   * lines, so programs taking interrupts can't be checked this way. Nor
+   * does it have devices: their stores aren't compared, and the first
+   * instruction to read one ends the checks, as what it reads depends on
+   * timing.
+   */
+  void EnableLockstep();
+  const std::optional<std::string>& divergence() const { return divergence_; }
+
+  // Write every traced step to an FST file.
+  void OpenTrace(const std::string& filename);
+  void CloseTrace();
+
+  TraceWindow& window() { return window_; }
+
+  Vtesttop* top() const { return top_.get(); }
+  const ClockGenerator& clk() const { return clock_gen_; }
+  RAMSim* ram() { return &ram_; }
+  RAMSim* prg() { return &prg_; }
+
+  // The other end of testtop's UART: Send() to it, and see what it has sent
+  // in uart_output().
+  UARTSim* uart() { return &uart_; }
+  std::string uart_output() const { return uart_out_.str(); }
+
+  // The other end of testtop's console, which takes a batch once it fills
+  // or drain_interval clocks after the first byte, and what it has taken.
+  // While held it takes nothing, so a store to a full console holds up the
+  // core until it's released.
+  void SetConsoleDrain(int drain_interval);
+  void HoldConsole(bool hold) { console_held_ = hold; }
+  std::string console_output() const { return console_out_.str(); }
+
+  // Instructions retired so far, counted from instr_retired_o.
+  int retired() const { return retired_; }
+
+ private:
+  void Lockstep(bool retired);
+  void LoadInstrRam();
+
+  std::unique_ptr<VerilatedContext> context_;
+  std::unique_ptr<Vtesttop> top_;
+  ClockGenerator clock_gen_;
+  RAMSim prg_;
+  RAMSim ram_;
+  TraceWindow window_;
+  std::ostringstream uart_out_;
+  UARTSim uart_;
+  std::ostringstream console_out_;
+  std::unique_ptr<ConsoleSim> console_;
+  bool console_held_ = false;
+  std::unique_ptr<VerilatedFstC> trace_;
+
+  int retired_ = 0;
+
+  std::unique_ptr<Emulator> emu_;
+  std::vector<IData> emu_ram_;
+  bool emu_synced_ = false;
+  bool check_pending_ = false;
+  // Whether an instruction awaiting the check read a device.
+  bool read_device_ = false;
+  std::optional<std::string> divergence_;
+  uint32_t lockstep_pc_ = 0;
+  std::string lockstep_instr_;
+  std::set<IData> rtl_stores_;
+  std::set<IData> emu_stores_;
+  // Where the instructions retired since the last check start: with the
+  // scoreboard, not necessarily in the same order.
+  std::multiset<IData> rtl_starts_;
+  std::multiset<IData> emu_starts_;
+
+  CData c_gnd_ = 0;
+  IData i_gnd_ = 0;
+};
@@ -1,4 +1,18 @@
-module testtop(
+`include "common.vh"
+
+module testtop #(
+    parameter PIPELINED = 0,
+    parameter PREFETCH_DEPTH = 0,
+    parameter SCOREBOARD = 0,
+    // Short, so tests needn't run for long to get a byte across.
+    parameter UART_CLKS_PER_BIT = 16,
+    // Small, so tests needn't write much to fill it.
+    parameter CONSOLE_DEPTH = 12,
+    // Fetch from a pipelined blkram, as simtop does with the prefetch
+    // buffer, rather than through the instr_ ports. The instr_ outputs
+    // still show the fetches, and TestBench loads the blkram.
+    parameter INSTR_BLKRAM = 0
+) (
     input wire rst_i,
     input wire sysclk_i,
 
@@ -16,42 +30,124 @@ module testtop(
     output logic [3:0] data_wstrb_o,
     input logic data_ready_i,
 
+    input wire uart_rxd_i,
+    output wire uart_txd_o,
+
+    output wire [8*CONSOLE_DEPTH-1:0] console_data_o,
+    output wire [$clog2(CONSOLE_DEPTH+1)-1:0] console_count_o,
+    input wire console_drain_i,
+
     output logic [31:0] cycles_executed_o,
-    output wire instr_done_o
+    output wire instr_done_o,
+    output wire instr_retired_o,
+    output wire instr_pending_o,
+    output wire [31:0] pc_o,
+    output wire [31:0] retire_start_pc_o,
+    output wire [32*32-1:0] regs_o
 );
 
     always @(posedge sysclk_i) begin
         if (rst_i) begin
             cycles_executed_o <= 32'b0;
+        end else begin
+            cycles_executed_o <= cycles_executed_o + 1;
         end
-        cycles_executed_o <= cycles_executed_o + 1;
     end
 
     bus_if data_bus;
+    bus_if mem_bus;
+    bus_if io_bus;
+    bus_if uart_bus;
+    bus_if console_bus;
     bus_if instr_bus;
+    io_split io_split(
+        .cpu_bus(data_bus.slave),
+        .mem_bus(mem_bus.master),
+        .io_bus(io_bus.master)
+    );
+    io_split #(
+        .BASE(CONSOLE_DATA)
+    ) console_split(
+        .cpu_bus(io_bus.slave),
+        .mem_bus(uart_bus.master),
+        .io_bus(console_bus.master)
+    );
+
     always_comb begin
-        data_bus.read_data = data_data_read_i;
-        data_bus.ready = data_ready_i;
-        data_data_write_o = data_bus.write_data;
-        data_valid_o = data_bus.valid;
-        data_wstrb_o = data_bus.wstrb;
-        data_addr_o = data_bus.addr;
-
-        instr_bus.read_data = instr_data_read_i;
-        instr_bus.ready = instr_ready_i;
+        mem_bus.read_data = data_data_read_i;
+        mem_bus.ready = data_ready_i;
+        mem_bus.accept = data_ready_i;
+        data_data_write_o = mem_bus.write_data;
+        data_valid_o = mem_bus.valid;
+        data_wstrb_o = mem_bus.wstrb;
+        data_addr_o = mem_bus.addr;
+
         instr_data_write_o = instr_bus.write_data;
         instr_valid_o = instr_bus.valid;
         instr_addr_o = instr_bus.addr;
         instr_instr_o = instr_bus.instr;
-
     end
 
-    tta tta(
+    generate
+        if (INSTR_BLKRAM) begin : instr_ram
+            blkram #(
+                .RAM_DEPTH(1024),  // TestBench::kMemorySize
+                .PIPELINED(1)
+            ) ram(
+                .clk_i(sysclk_i),
+                .rst_i(rst_i),
+                .data_bus(instr_bus.slave)
+            );
+        end else begin : instr_port
+            always_comb begin
+                instr_bus.read_data = instr_data_read_i;
+                instr_bus.ready = instr_ready_i;
+                instr_bus.accept = instr_ready_i;
+            end
+        end
+    endgenerate
+
+    wire uart_rx_ready;
+    wire uart_tx_empty;
+    uart #(
+        .CLKS_PER_BIT(UART_CLKS_PER_BIT)
+    ) uart(
+        .clk_i(sysclk_i),
+        .rst_i(rst_i),
+        .bus(uart_bus.slave),
+        .rxd_i(uart_rxd_i),
+        .txd_o(uart_txd_o),
+        .rx_ready_o(uart_rx_ready),
+        .tx_empty_o(uart_tx_empty)
+    );
+
+    console #(
+        .DEPTH(CONSOLE_DEPTH)
+    ) console(
+        .clk_i(sysclk_i),
+        .rst_i(rst_i),
+        .bus(console_bus.slave),
+        .data_o(console_data_o),
+        .count_o(console_count_o),
+        .drain_i(console_drain_i)
+    );
+
+    tta #(
+        .PIPELINED(PIPELINED),
+        .PREFETCH_DEPTH(PREFETCH_DEPTH),
+        .SCOREBOARD(SCOREBOARD)
+    ) tta(
         .rst_i(rst_i),
         .clk_i(sysclk_i),
         .instr_bus(instr_bus),
         .data_bus(data_bus),
-        .instr_done_o(instr_done_o)
+        .irq_i({6'b0, uart_tx_empty, uart_rx_ready}),
+        .instr_done_o(instr_done_o),
+        .instr_retired_o(instr_retired_o),
+        .instr_pending_o(instr_pending_o),
+        .pc_o(pc_o),
+        .retire_start_pc_o(retire_start_pc_o),
+        .regs_o(regs_o)
     );
 
 endmodule : testtop
\ No newline at end of file
@@ -0,0 +1,756 @@
+#include "text_assembler.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "emulator.h"
+
+namespace {
+
+bool IsWordChar(char c) {
+  return isalnum((unsigned char)c) || c == '_';
+}
+
+// Whether word reads as a number, hex with or without 0x, and if so its
+// value and how many digits it was written with.
+bool ParseNumber(const std::string& word, uint64_t* value, int* digits) {
+  size_t start = 0;
+  if (word.size() > 2 && word[0] == '0' && (word[1] == 'x' || word[1] == 'X'))
+    start = 2;
+  if (start == word.size())
+    return false;
+  uint64_t v = 0;
+  for (size_t i = start; i < word.size(); i++) {
+    const char c = word[i];
+    if (!isxdigit((unsigned char)c))
+      return false;
+    v = v << 4U | (isdigit((unsigned char)c) ? c - '0' : tolower(c) - 'a' + 10);
+  }
+  *digits = word.size() - start;
+  *value = *digits > 8 ? UINT64_MAX : v;
+  return true;
+}
+
+bool IsNumber(const std::string& word) {
+  uint64_t value;
+  int digits;
+  return ParseNumber(word, &value, &digits);
+}
+
+std::optional<MemWidth> WidthNamed(const std::string& name) {
+  if (name == "b")
+    return MemWidth::MEM_BYTE;
+  if (name == "sb")
+    return MemWidth::MEM_BYTE_SIGNED;
+  if (name == "h")
+    return MemWidth::MEM_HALF;
+  if (name == "sh")
+    return MemWidth::MEM_HALF_SIGNED;
+  return {};
+}
+
+// Whether an instruction never falls through to the next, or is one a
+// handler returns from.
+bool EndsBlock(const Instr& instr) {
+  const Unit dst = (Unit)instr.op().dst_unit;
+  return dst == Unit::UNIT_PC ||
+         (dst == Unit::UNIT_CONTROL &&
+          instr.op().di == (unsigned)ControlReg::CTRL_IRQ_RETURN);
+}
+
+}  // namespace
+
+// Reads a line a token at a time, skipping whitespace.
+class TextAssembler::Cursor {
+ public:
+  explicit Cursor(const std::string& s) : s_(s) {}
+
+  bool AtEnd() {
+    Skip();
+    return pos_ == s_.size();
+  }
+  // Consume tok if it's next.
+  bool Eat(const std::string& tok) {
+    Skip();
+    if (s_.compare(pos_, tok.size(), tok) != 0)
+      return false;
+    pos_ += tok.size();
+    return true;
+  }
+  // Letters, digits and underscores, or nothing if something else is next.
+  std::string Word() {
+    Skip();
+    const size_t start = pos_;
+    while (pos_ < s_.size() && IsWordChar(s_[pos_]))
+      pos_++;
+    return s_.substr(start, pos_ - start);
+  }
+  // A colon straight after the last word, ending it as a label.
+  bool EatLabelColon() {
+    if (pos_ >= s_.size() || s_[pos_] != ':' ||
+        (pos_ + 1 < s_.size() && !isspace((unsigned char)s_[pos_ + 1])))
+      return false;
+    pos_++;
+    return true;
+  }
+  std::string Rest() {
+    Skip();
+    return s_.substr(pos_);
+  }
+
+  size_t pos() const { return pos_; }
+  void set_pos(size_t pos) { pos_ = pos; }
+
+ private:
+  void Skip() {
+    while (pos_ < s_.size() && isspace((unsigned char)s_[pos_]))
+      pos_++;
+  }
+
+  const std::string& s_;
+  size_t pos_ = 0;
+};
+
+// A source or destination as written: a unit with its immediate, or one of
+// the # and *() forms with the value it's to have.
+struct TextAssembler::UnitSpec {
+  enum { kUnit, kAbsolute, kMemory } form = kUnit;
+  Unit unit = Unit::UNIT_NONE;
+  unsigned immediate = 0;
+  Expr value;
+  bool long_literal = false;
+  MemWidth width = MemWidth::MEM_WORD;
+};
+
+bool TextAssembler::Error(int line, const std::string& message) {
+  LOG(ERROR) << name_ << ":" << line << ": " << message;
+  errors_++;
+  return false;
+}
+
+bool TextAssembler::Define(const std::string& name, uint32_t value, int line) {
+  if (IsNumber(name))
+    return Error(line, "'" + name + "' reads as a number");
+  if (!isalpha((unsigned char)name[0]) && name[0] != '_')
+    return Error(line, "'" + name + "' isn't a symbol");
+  if (symbols_.count(name) || labels_.count(name))
+    return Error(line, "'" + name + "' is already defined");
+  symbols_[name] = value;
+  return true;
+}
+
+bool TextAssembler::DefineLabel(const std::string& name, int line) {
+  if (!Define(name, 0, line))
+    return false;
+  symbols_.erase(name);
+  labels_[name] = 0;
+  return true;
+}
+
+void TextAssembler::FlushLabels(int line) {
+  if (pending_labels_.empty())
+    return;
+  Statement st = {};
+  st.line = line;
+  st.section = section_;
+  st.labels.swap(pending_labels_);
+  statements_.push_back(std::move(st));
+}
+
+std::optional<uint32_t> TextAssembler::symbol(const std::string& name) const {
+  for (const auto* symbols : {&symbols_, &labels_}) {
+    const auto it = symbols->find(name);
+    if (it != symbols->end())
+      return it->second;
+  }
+  return {};
+}
+
+std::optional<uint32_t> TextAssembler::Evaluate(const Expr& e,
+                                                int line,
+                                                bool report) {
+  uint32_t v = 0;
+  for (const Term& t : e) {
+    uint32_t term = t.value;
+    if (!t.symbol.empty()) {
+      const auto it = symbols_.find(t.symbol);
+      const auto label = labels_.find(t.symbol);
+      if (it != symbols_.end()) {
+        term = it->second;
+      } else if (laid_out_ && label != labels_.end()) {
+        term = label->second;
+      } else {
+        if (report)
+          Error(line, "'" + t.symbol + "' isn't defined");
+        return {};
+      }
+    }
+    v = t.negate ? v - term : v + term;
+  }
+  return v;
+}
+
+bool TextAssembler::ParseExpr(Cursor& c,
+                              Expr* e,
+                              bool* long_literal,
+                              int line) {
+  bool negate = c.Eat("-");
+  do {
+    const std::string word = c.Word();
+    if (word.empty())
+      return Error(line, "expected a value at '" + c.Rest() + "'");
+    Term t = {negate, "", 0};
+    uint64_t value;
+    int digits;
+    if (ParseNumber(word, &value, &digits)) {
+      if (value > UINT32_MAX)
+        return Error(line, word + " doesn't fit in 32 bits");
+      t.value = value;
+      if (digits >= 8 && long_literal)
+        *long_literal = true;
+    } else {
+      t.symbol = word;
+    }
+    e->push_back(t);
+    if (c.Eat("+"))
+      negate = false;
+    else if (c.Eat("-"))
+      negate = true;
+    else
+      break;
+  } while (true);
+  return true;
+}
+
+bool TextAssembler::ParseUnit(Cursor& c, UnitSpec* u, int line) {
+  const auto width = [&]() {
+    if (!c.Eat("."))
+      return true;
+    const std::string suffix = c.Word();
+    const auto w = WidthNamed(suffix);
+    if (!w)
+      return Error(line, "unknown access width '." + suffix + "'");
+    u->width = *w;
+    return true;
+  };
+  // "R" and a register number, for register pointers.
+  const auto pointer = [&](PtrMode mode) {
+    const std::string word = c.Word();
+    uint64_t r;
+    int digits;
+    if (word.size() < 2 || word[0] != 'R' ||
+        !ParseNumber(word.substr(1), &r, &digits) ||
+        r >= Emulator::kNumRegisters)
+      return Error(line, "expected a register pointer at '" + word + "'");
+    u->unit = Unit::UNIT_REGISTER_POINTER;
+    if (mode == PtrMode::PTR_PLAIN && c.Eat("++"))
+      mode = PtrMode::PTR_POST_INC;
+    if (!width())
+      return false;
+    u->immediate = r | (unsigned)mode << 6U | (unsigned)u->width << 8U;
+    return true;
+  };
+
+  if (c.Eat("#")) {
+    u->form = UnitSpec::kAbsolute;
+    return ParseExpr(c, &u->value, &u->long_literal, line);
+  }
+  if (c.Eat("*(")) {
+    u->form = UnitSpec::kMemory;
+    if (!ParseExpr(c, &u->value, &u->long_literal, line))
+      return false;
+    if (!c.Eat(")"))
+      return Error(line, "expected ')' at '" + c.Rest() + "'");
+    return width();
+  }
+  if (c.Eat("*--"))
+    return pointer(PtrMode::PTR_PRE_DEC);
+  if (c.Eat("*"))
+    return pointer(PtrMode::PTR_PLAIN);
+
+  const std::string word = c.Word();
+  // The number after a unit's name, below how many of the unit there are.
+  // Control registers are sparse, so those only have to fit the field.
+  const auto index = [&](size_t prefix, Unit unit, uint64_t count) {
+    uint64_t i;
+    int digits;
+    if (!ParseNumber(word.substr(prefix), &i, &digits))
+      return Error(line, "bad unit number in '" + word + "'");
+    if (i >= count) {
+      std::ostringstream s;
+      s << std::hex << "no unit '" << word << "', the numbers go up to "
+        << count - 1;
+      return Error(line, s.str());
+    }
+    u->unit = unit;
+    u->immediate = i;
+    return true;
+  };
+  if (word == "_")
+    u->unit = Unit::UNIT_NONE;
+  else if (word == "STACK")
+    u->unit = Unit::UNIT_STACK_PUSH_POP;
+  else if (word == "PC")
+    u->unit = Unit::UNIT_PC;
+  else if (word.rfind("ALU", 0) == 0) {
+    // ALU numbers are decimal in the disassembly, but never past 9.
+    if (!index(3, Unit::UNIT_ALU_LEFT, Emulator::kNumALUs))
+      return false;
+    if (!c.Eat(":"))
+      return Error(line, "expected ALUn:PORT at '" + word + "'");
+    const std::string port = c.Word();
+    if (port == "LEFT")
+      u->unit = Unit::UNIT_ALU_LEFT;
+    else if (port == "RIGHT")
+      u->unit = Unit::UNIT_ALU_RIGHT;
+    else if (port == "OPERATOR")
+      u->unit = Unit::UNIT_ALU_OPERATOR;
+    else if (port == "RESULT")
+      u->unit = Unit::UNIT_ALU_RESULT;
+    else
+      return Error(line, "unknown ALU port '" + port + "'");
+  } else if (word.rfind("CTRL", 0) == 0)
+    return index(4, Unit::UNIT_CONTROL, 1U << 12U);
+  else if (word.size() > 1 && word[0] == 'R')
+    return index(1, Unit::UNIT_REGISTER, Emulator::kNumRegisters);
+  else if (word.size() > 1 && word[0] == 'S')
+    return index(1, Unit::UNIT_STACK_INDEX, Emulator::kStackDepth);
+  else
+    return Error(line, "unknown unit at '" + word + c.Rest() + "'");
+  return true;
+}
+
+bool TextAssembler::ParseMove(Cursor& c,
+                              Instr* instr,
+                              std::vector<Pending>* operands,
+                              int line) {
+  const size_t start = c.pos();
+  if (c.Word() == "NOP") {
+    *instr = Instr();
+    return true;
+  }
+  c.set_pos(start);
+
+  UnitSpec dst, src;
+  if (!ParseUnit(c, &dst, line))
+    return false;
+  if (!c.Eat(":="))
+    return Error(line, "expected ':=' at '" + c.Rest() + "'");
+  if (!ParseUnit(c, &src, line))
+    return false;
+
+  for (const UnitSpec* u : {&dst, &src}) {
+    const bool is_dst = u == &dst;
+    Unit unit = u->unit;
+    unsigned immediate = u->immediate;
+    if (u->form != UnitSpec::kUnit) {
+      const bool absolute = u->form == UnitSpec::kAbsolute;
+      const bool may_shrink =
+          u->width == MemWidth::MEM_WORD &&
+          (!u->long_literal || (optimizer_ && optimizer_->shrink_operands));
+      const auto known = Evaluate(u->value, line, false);
+      if (known && *known < 1U << 12U && may_shrink) {
+        unit = absolute ? Unit::UNIT_ABS_IMMEDIATE
+                        : Unit::UNIT_MEMORY_IMMEDIATE;
+        immediate = *known;
+      } else {
+        // Labels have their values once laid out.
+        unit = absolute ? Unit::UNIT_ABS_OPERAND : Unit::UNIT_MEMORY_OPERAND;
+        immediate = (unsigned)u->width << 8U;
+        operands->push_back({is_dst, absolute, u->width, u->value,
+                             may_shrink && !known, false, false});
+      }
+    }
+    if (is_dst)
+      instr->Dst(unit).Di(immediate);
+    else
+      instr->Src(unit).Si(immediate);
+  }
+  return true;
+}
+
+bool TextAssembler::ParseLine(const std::string& text, int line) {
+  const std::string code =
+      text.substr(0, std::min(text.find("//"), text.find(';')));
+  Cursor c(code);
+
+  for (;;) {
+    const size_t start = c.pos();
+    const std::string word = c.Word();
+    if (word.empty() || !c.EatLabelColon()) {
+      c.set_pos(start);
+      break;
+    }
+    if (DefineLabel(word, line))
+      pending_labels_.push_back(word);
+  }
+  if (c.AtEnd())
+    return true;
+
+  Statement st = {};
+  st.line = line;
+  if (c.Eat(".")) {
+    const std::string directive = c.Word();
+    // A value which doesn't depend on the layout.
+    const auto constant = [&](uint32_t* v) {
+      Expr e;
+      if (!ParseExpr(c, &e, nullptr, line))
+        return false;
+      const auto value = Evaluate(e, line, false);
+      if (!value)
+        return Error(line, "." + directive +
+                               " takes numbers and earlier .equ symbols");
+      *v = *value;
+      return true;
+    };
+
+    if (directive == "code" || directive == "data") {
+      FlushLabels(line);
+      section_ = directive == "code" ? Section::kCode : Section::kData;
+    } else if (directive == "org") {
+      st.org.emplace();
+      if (!constant(&*st.org))
+        return false;
+    } else if (directive == "equ") {
+      const std::string name = c.Word();
+      uint32_t v;
+      if (!c.Eat(","))
+        return Error(line, "expected .equ NAME, VALUE");
+      if (!constant(&v))
+        return false;
+      Define(name, v, line);
+    } else if (directive == "word") {
+      do {
+        Expr e;
+        if (!ParseExpr(c, &e, nullptr, line))
+          return false;
+        st.data.push_back(e);
+      } while (c.Eat(","));
+      st.size = st.data.size();
+    } else if (directive == "space") {
+      if (!constant(&st.size))
+        return false;
+    } else {
+      return Error(line, "unknown directive '." + directive + "'");
+    }
+  } else {
+    Instr instr;
+    std::optional<UnitSpec> guard;
+    bool invert = false;
+    if (c.Eat("(")) {
+      invert = c.Eat("!");
+      guard.emplace();
+      if (!ParseUnit(c, &*guard, line))
+        return false;
+      if (guard->form != UnitSpec::kUnit ||
+          (guard->unit != Unit::UNIT_REGISTER &&
+           guard->unit != Unit::UNIT_ALU_RESULT) ||
+          guard->immediate >= 1U << 8U)
+        return Error(line, "guards take a register or an ALU result");
+      if (!c.Eat(")"))
+        return Error(line, "expected ')' at '" + c.Rest() + "'");
+    }
+    if (!ParseMove(c, &instr, &st.operands, line))
+      return false;
+    if (c.Eat("||")) {
+      Instr paired;
+      std::vector<Pending> paired_operands;
+      if (!ParseMove(c, &paired, &paired_operands, line))
+        return false;
+      if (!paired_operands.empty() || !Instr::CanPair(paired.op()))
+        return Error(line, paired.ToString() + " can't be bundled");
+      instr.Pair(paired);
+    }
+    if (guard) {
+      if (invert)
+        instr.IfNot(guard->unit, guard->immediate);
+      else
+        instr.If(guard->unit, guard->immediate);
+    }
+    st.size = instr.size();
+    st.instr = instr;
+  }
+  if (!c.AtEnd())
+    return Error(line, "unexpected '" + c.Rest() + "'");
+
+  if (st.size != 0 || st.org) {
+    st.section = section_;
+    st.labels.swap(pending_labels_);
+    statements_.push_back(std::move(st));
+  }
+  return true;
+}
+
+std::vector<std::vector<size_t>> TextAssembler::BlockStatements() const {
+  std::vector<std::vector<size_t>> blocks;
+  bool open = false;
+  for (size_t i = 0; i < statements_.size(); i++) {
+    const Statement& st = statements_[i];
+    if (st.section != Section::kCode)
+      continue;
+    if (!st.instr) {
+      open = false;
+      continue;
+    }
+    if (!open || !st.labels.empty())
+      blocks.emplace_back();
+    blocks.back().push_back(i);
+    open = !EndsBlock(*st.instr);
+  }
+  return blocks;
+}
+
+void TextAssembler::Optimize() {
+  // Each block's statements, as they are to be, in place of its first.
+  std::map<size_t, std::vector<Statement>> replacements;
+  std::vector<bool> replaced(statements_.size(), false);
+  for (const std::vector<size_t>& block : BlockStatements()) {
+    Program program;
+    for (size_t i : block) {
+      program.push_back(*statements_[i].instr);
+      replaced[i] = true;
+    }
+    std::vector<Statement>& out = replacements[block[0]];
+    for (size_t k : PlanBlock(program, *optimizer_)) {
+      out.push_back(statements_[block[k]]);
+      out.back().labels.clear();
+    }
+    Statement& first = statements_[block[0]];
+    if (out.empty() && !first.labels.empty()) {
+      out.push_back({});
+      out.back().line = first.line;
+      out.back().section = first.section;
+    }
+    if (!out.empty())
+      out.front().labels = first.labels;
+  }
+
+  std::vector<Statement> statements;
+  for (size_t i = 0; i < statements_.size(); i++) {
+    const auto it = replacements.find(i);
+    if (it != replacements.end()) {
+      for (Statement& st : it->second)
+        statements.push_back(std::move(st));
+    } else if (!replaced[i]) {
+      statements.push_back(std::move(statements_[i]));
+    }
+  }
+  statements_.swap(statements);
+}
+
+void TextAssembler::Layout() {
+  for (;;) {
+    uint32_t addr[2] = {};
+    for (Statement& st : statements_) {
+      uint32_t& next = addr[(int)st.section];
+      if (st.org)
+        next = *st.org;
+      st.addr = next;
+      for (const std::string& label : st.labels)
+        labels_[label] = st.addr;
+      if (st.instr) {
+        for (const Pending& p : st.operands) {
+          const Unit u = p.shrunk ? (p.absolute ? Unit::UNIT_ABS_IMMEDIATE
+                                                : Unit::UNIT_MEMORY_IMMEDIATE)
+                                  : (p.absolute ? Unit::UNIT_ABS_OPERAND
+                                                : Unit::UNIT_MEMORY_OPERAND);
+          if (p.dst)
+            st.instr->Dst(u);
+          else
+            st.instr->Src(u);
+        }
+        st.size = st.instr->size();
+      }
+      next += st.size;
+    }
+    laid_out_ = true;
+
+    // Shrinking only ever moves code down, but differences of labels can
+    // grow, so anything which stops fitting stays an operand from then on.
+    bool changed = false;
+    for (Statement& st : statements_) {
+      for (Pending& p : st.operands) {
+        if (!p.relax || p.pinned)
+          continue;
+        const auto v = Evaluate(p.value, st.line, false);
+        const bool fits = v && *v < 1U << 12U;
+        if (fits != p.shrunk) {
+          p.pinned = p.shrunk;
+          p.shrunk = fits;
+          changed = true;
+        }
+      }
+    }
+    if (!changed)
+      return;
+  }
+}
+
+void TextAssembler::Emit() {
+  std::vector<bool> written[2];
+  for (Statement& st : statements_) {
+    std::vector<uint32_t>& image = images_[(int)st.section];
+    std::vector<bool>& used = written[(int)st.section];
+    if (image.size() < st.addr + st.size) {
+      image.resize(st.addr + st.size);
+      used.resize(image.size());
+    }
+    if (std::find(used.begin() + st.addr, used.begin() + st.addr + st.size,
+                  true) != used.begin() + st.addr + st.size)
+      Error(st.line, "overlaps words already assembled");
+    std::fill(used.begin() + st.addr, used.begin() + st.addr + st.size, true);
+
+    uint32_t* out = image.data() + st.addr;
+    if (st.instr) {
+      for (const Pending& p : st.operands) {
+        const uint32_t v = Evaluate(p.value, st.line, true).value_or(0);
+        if (p.shrunk && p.dst)
+          st.instr->Di(v);
+        else if (p.shrunk)
+          st.instr->Si(v);
+        else if (p.dst)
+          st.instr->Di((unsigned)p.width << 8U).Doperand(v);
+        else
+          st.instr->Si((unsigned)p.width << 8U).Soperand(v);
+      }
+      st.instr->AssembleTo(out);
+    } else {
+      for (size_t i = 0; i < st.data.size(); i++)
+        out[i] = Evaluate(st.data[i], st.line, true).value_or(0);
+    }
+  }
+}
+
+void TextAssembler::FindBlocks() {
+  for (const std::vector<size_t>& block : BlockStatements()) {
+    const Statement& first = statements_[block[0]];
+    Block b = {first.labels.empty() ? "" : first.labels[0], first.addr, 0, 0,
+               0};
+    for (size_t i : block) {
+      b.words += statements_[i].size;
+      b.instructions++;
+      b.clocks += Emulator::Cycles(*statements_[i].instr);
+    }
+    blocks_.push_back(b);
+  }
+}
+
+bool TextAssembler::Assemble(const std::string& source,
+                             const std::string& name) {
+  const auto optimizer = optimizer_;
+  *this = TextAssembler();
+  optimizer_ = optimizer;
+  name_ = name;
+
+  std::istringstream in(source);
+  std::string text;
+  int line = 0;
+  while (std::getline(in, text)) {
+    if (!text.empty() && text.back() == '\r')
+      text.pop_back();
+    ParseLine(text, ++line);
+  }
+  FlushLabels(line);
+  if (errors_ != 0)
+    return false;
+
+  if (optimizer_)
+    Optimize();
+  Layout();
+  Emit();
+  FindBlocks();
+  return errors_ == 0;
+}
+
+bool TextAssembler::AssembleFile(const std::string& filename) {
+  std::ifstream in(filename);
+  if (!in) {
+    LOG(ERROR) << "Can't open " << filename;
+    return false;
+  }
+  std::ostringstream source;
+  source << in.rdbuf();
+  return Assemble(source.str(), filename);
+}
+
+void TextAssembler::WriteMem(std::ostream& out, Section s) const {
+  std::vector<const Statement*> in_order;
+  for (const Statement& st : statements_) {
+    if (st.section == s)
+      in_order.push_back(&st);
+  }
+  std::stable_sort(in_order.begin(), in_order.end(),
+                   [](const Statement* a, const Statement* b) {
+                     return a->addr < b->addr;
+                   });
+
+  constexpr size_t kWordsPerLine = 8;
+  const std::vector<uint32_t>& image = images_[(int)s];
+  uint32_t next = 0;
+  out << std::hex << std::setfill('0');
+  for (const Statement* st : in_order) {
+    if (st->size == 0)
+      continue;
+    if (st->addr != next)
+      out << "@" << st->addr << "\n";
+    std::string comment;
+    for (const std::string& label : st->labels)
+      comment += (comment.empty() ? "" : " ") + label + ":";
+    if (st->instr)
+      comment += (comment.empty() ? "" : " ") + st->instr->ToString();
+    for (uint32_t i = 0; i < st->size; i++) {
+      out << std::setw(8) << image[st->addr + i];
+      if (i + 1 == st->size || (i + 1) % kWordsPerLine == 0) {
+        if (!comment.empty())
+          out << "  // " << comment;
+        comment.clear();
+        out << "\n";
+      } else {
+        out << " ";
+      }
+    }
+    next = st->addr + st->size;
+  }
+  out << std::dec << std::setfill(' ');
+}
+
+bool TextAssembler::WriteFile(const std::string& filename, Section s) const {
+  const bool binary = filename.size() >= 4 &&
+                      filename.compare(filename.size() - 4, 4, ".bin") == 0;
+  std::ofstream out(filename, binary ? std::ios::binary : std::ios::out);
+  if (binary) {
+    const std::vector<uint32_t>& image = images_[(int)s];
+    out.write(reinterpret_cast<const char*>(image.data()),
+              image.size() * sizeof(uint32_t));
+  } else {
+    WriteMem(out, s);
+  }
+  if (!out) {
+    LOG(ERROR) << "Writing " << filename;
+    return false;
+  }
+  return true;
+}
+
+void TextAssembler::WriteReport(std::ostream& out) const {
+  out << "  addr  words  instrs  clocks  block\n";
+  uint32_t words = 0;
+  int instructions = 0;
+  for (const Block& b : blocks_) {
+    out << std::hex << std::setfill('0') << "  " << std::setw(4) << b.addr
+        << std::dec << std::setfill(' ') << std::setw(7) << b.words
+        << std::setw(8) << b.instructions << std::setw(8) << b.clocks << "  "
+        << b.label << "\n";
+    words += b.words;
+    instructions += b.instructions;
+  }
+  out << "  total" << std::setw(6) << words << std::setw(8) << instructions
+      << "\n";
+  out << "Clocks are once through, unpipelined, without waits on busy "
+         "ALUs.\n";
+}
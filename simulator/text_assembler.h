@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "assembler.h"
+#include "optimizer.h"
+
+// Two-pass assembler for programs written the way Instr::ToString() prints
+// them, one instruction a line, e.g.
+//
+//   // Add up the words from table to the zero ending it.
+//           R00 := #0
+//           R01 := #table
+//   loop:   R02 := *R01++
+//           (!R02) PC := #done
+//           ALU0:LEFT := R00 || ALU0:RIGHT := R02
+//           ALU0:OPERATOR := #001
+//           R00 := ALU0:RESULT
+//           PC := #loop
+//   done:   *(total) := R00
+//
+//           .data
+//   table:  .word 1, 2, 3, 0
+//   total:  .space 1
+//
+// Labels ("name:" ahead of an instruction or directive) can be used
+// anywhere a number can, ahead of their definition too. The directives are
+//
+//   .code, .data    assemble into program or data memory, each of which
+//                   has its own address, the first starting out
+//   .org A          carry on at word address A
+//   .word V, ...    words
+//   .space N        N zero words
+//   .equ NAME, V    define a symbol
+//
+// Numbers are hex, as the disassembly prints them, with or without 0x, and
+// values can add and subtract numbers and symbols. .org, .space and .equ
+// take values which don't depend on labels. A symbol which reads as a
+// number can't be defined. "//" and ";" start comments.
+//
+// #V and *(V) take the 12 bit immediate forms, UNIT_ABS_IMMEDIATE and
+// UNIT_MEMORY_IMMEDIATE, wherever V fits, saving the operand fetch, and the
+// 32 bit operand forms otherwise and for numbers written with eight digits,
+// as the disassembly prints operands. Values using labels start out as
+// operands and are made immediates as the layout allows.
+//
+// With set_optimizer(), each basic block goes through PlanBlock() (see
+// optimizer.h) before it's laid out.
+class TextAssembler {
+ public:
+  enum class Section { kCode, kData };
+
+  // Optimize each block, as optimizer.h describes. Values which fit are
+  // made immediates either way; shrink_operands makes eight digit numbers
+  // immediates too.
+  void set_optimizer(const OptimizerOptions& options) { optimizer_ = options; }
+
+  // A run of code only entered at the top: from a label, or the instruction
+  // after a jump, up to the next of either.
+  struct Block {
+    std::string label;  // The first at its start, if any
+    uint32_t addr;
+    uint32_t words;
+    int instructions;
+    // Once through, estimated by Emulator::Cycles(). Waits on busy ALUs
+    // aren't counted.
+    int clocks;
+  };
+
+  // Assemble source, logging errors against name and line. Returns whether
+  // there were none. Each call starts afresh.
+  bool Assemble(const std::string& source, const std::string& name = "-");
+  bool AssembleFile(const std::string& filename);
+
+  // Addresses 0 up to the last word assembled, with any gaps zero.
+  const std::vector<uint32_t>& image(Section s = Section::kCode) const {
+    return images_[(int)s];
+  }
+  // Labels and .equ symbols.
+  std::optional<uint32_t> symbol(const std::string& name) const;
+  const std::vector<Block>& blocks() const { return blocks_; }
+
+  // An image as $readmemh text, as blkram loads bootmem.mem: each
+  // instruction's words on a line of their own, with its disassembly.
+  void WriteMem(std::ostream& out, Section s = Section::kCode) const;
+  // The same to a file, or host order words for ".bin" files, as
+  // MemoryImage::Load() reads them.
+  bool WriteFile(const std::string& filename,
+                 Section s = Section::kCode) const;
+  // Size and clocks of each block, and in total.
+  void WriteReport(std::ostream& out) const;
+
+ private:
+  // Numbers and symbols, added together or subtracted.
+  struct Term {
+    bool negate;
+    std::string symbol;  // Or, if empty, value
+    uint32_t value;
+  };
+  using Expr = std::vector<Term>;
+
+  // A #V or *(V) source or destination to fill in once laid out: as an
+  // immediate if shrunk, and otherwise as an operand.
+  struct Pending {
+    bool dst;
+    bool absolute;  // #V, rather than *(V)
+    MemWidth width;
+    Expr value;
+    // Whether it may be shrunk, and whether it has turned out not to fit
+    // after all, which keeps it an operand so that the layout settles.
+    bool relax;
+    bool pinned;
+    bool shrunk;
+  };
+
+  // A line which assembles to words, or moves on the address.
+  struct Statement {
+    int line;
+    Section section;
+    uint32_t addr;
+    std::vector<std::string> labels;
+    // An instruction, with values to fill in once laid out,
+    std::optional<Instr> instr;
+    std::vector<Pending> operands;
+    // data words,
+    std::vector<Expr> data;
+    // or .org.
+    std::optional<uint32_t> org;
+    uint32_t size;
+  };
+
+  class Cursor;
+  struct UnitSpec;
+
+  bool Error(int line, const std::string& message);
+  bool ParseLine(const std::string& text, int line);
+  bool ParseExpr(Cursor& c, Expr* e, bool* long_literal, int line);
+  bool ParseUnit(Cursor& c, UnitSpec* u, int line);
+  bool ParseMove(Cursor& c,
+                 Instr* instr,
+                 std::vector<Pending>* operands,
+                 int line);
+  // Check a new symbol's name, and define it.
+  bool Define(const std::string& name, uint32_t value, int line);
+  bool DefineLabel(const std::string& name, int line);
+  // Statements given labels since the last, ahead of a change of section.
+  void FlushLabels(int line);
+  // Nothing if e uses a symbol not yet defined, which is an error if
+  // report is set. Labels have no value until laid out.
+  std::optional<uint32_t> Evaluate(const Expr& e, int line, bool report);
+  // The statements of each basic block, as Block describes.
+  std::vector<std::vector<size_t>> BlockStatements() const;
+  void Optimize();
+  // Give statements their addresses and labels their values, shrinking
+  // operands until nothing more fits.
+  void Layout();
+  void Emit();
+  void FindBlocks();
+
+  std::string name_;
+  int errors_ = 0;
+  Section section_ = Section::kCode;
+  std::optional<OptimizerOptions> optimizer_;
+  std::map<std::string, uint32_t> symbols_;
+  std::map<std::string, uint32_t> labels_;
+  bool laid_out_ = false;
+  // Labels on lines of their own, for the next statement.
+  std::vector<std::string> pending_labels_;
+  std::vector<Statement> statements_;
+  std::vector<uint32_t> images_[2];
+  std::vector<Block> blocks_;
+};
@@ -0,0 +1,85 @@
+#include "text_assembler.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include "emulator.h"
+
+// The example in text_assembler.h, with a halt on the end.
+constexpr char kSumSource[] = R"(
+        // Add up the words from table to the zero ending it.
+        R00 := #0
+        R01 := #table
+loop:   R02 := *R01++
+        (!R02) PC := #done
+        ALU0:LEFT := R00 || ALU0:RIGHT := R02
+        ALU0:OPERATOR := #001
+        R00 := ALU0:RESULT
+        PC := #loop
+done:   *(total) := R00
+halt:   PC := #halt
+
+        .data
+        .org 10
+table:  .word 1, 2, 3 + 4, 0
+total:  .space 1
+)";
+
+TEST(TextAssemblerTest, Example) {
+  TextAssembler assembler;
+  ASSERT_TRUE(assembler.Assemble(kSumSource));
+  const auto& code = assembler.image();
+  const auto& data = assembler.image(TextAssembler::Section::kData);
+  std::vector<IData> prg(1024), ram(1024);
+  std::copy(code.begin(), code.end(), prg.begin());
+  std::copy(data.begin(), data.end(), ram.begin());
+  EXPECT_EQ(assembler.symbol("table"), 0x10u);
+  EXPECT_EQ(assembler.symbol("total"), 0x14u);
+
+  Emulator emu(prg, ram);
+  emu.Run(100);
+  EXPECT_EQ(emu.pc(), *assembler.symbol("halt"));
+  EXPECT_EQ(ram[0x14], 1 + 2 + 7);
+
+  // The start, the loop and the rest of it after the jump out, done and
+  // halt.
+  const auto& blocks = assembler.blocks();
+  ASSERT_EQ(blocks.size(), 5u);
+  EXPECT_EQ(blocks[1].label, "loop");
+  EXPECT_EQ(blocks[1].instructions, 2);
+  EXPECT_EQ(blocks[2].instructions, 4);
+  EXPECT_EQ(blocks[3].label, "done");
+
+  // What the disassembly prints assembles back to the same words.
+  std::ostringstream source;
+  for (size_t pc = 0; pc < code.size();) {
+    const Instr instr = Instr::Disassemble(&code[pc]);
+    source << instr.ToString() << "\n";
+    pc += instr.size();
+  }
+  TextAssembler again;
+  ASSERT_TRUE(again.Assemble(source.str()));
+  EXPECT_EQ(again.image(), code);
+
+  EXPECT_FALSE(again.Assemble("R00 := #nowhere"));
+  EXPECT_FALSE(again.Assemble("add: R00 := #1"));
+}
+
+// Unit numbers stop at how many of the unit there are.
+TEST(TextAssemblerTest, UnitBounds) {
+  TextAssembler assembler;
+  EXPECT_TRUE(assembler.Assemble(
+      "R1f := S0ff\nALU7:LEFT := R00\nCTRL123 := R00"));
+  for (const char* source :
+       {"R00 := #0\nR99 := #1", "R00 := #0\nALU9:LEFT := R00",
+        "R00 := #0\nR20 := S100"}) {
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(assembler.Assemble(source)) << source;
+    EXPECT_NE(testing::internal::GetCapturedStderr().find("-:2: no unit"),
+              std::string::npos)
+        << source;
+  }
+}
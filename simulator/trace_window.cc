@@ -0,0 +1,95 @@
+#include "trace_window.h"
+
+#include <absl/flags/flag.h>
+
+#include <cstdio>
+
+ABSL_FLAG(int64_t,
+          trace_start_pc,
+          -1,
+          "Only start tracing once the PC reaches this address");
+ABSL_FLAG(int64_t,
+          trace_start_data_addr,
+          -1,
+          "Only start tracing once the data bus accesses this address");
+ABSL_FLAG(int,
+          trace_start_cycle,
+          -1,
+          "Only start tracing after this many bus cycles");
+ABSL_FLAG(int,
+          trace_window,
+          0,
+          "Stop tracing this many bus cycles after it started; 0 traces until "
+          "the end of the run");
+ABSL_FLAG(int,
+          trace_history,
+          64,
+          "Number of most recent bus cycles to keep in memory for dumping on "
+          "failure or exit");
+
+TraceWindow::TraceWindow(const Trigger& trigger,
+                         int window_cycles,
+                         size_t history_cycles)
+    : trigger_(trigger),
+      window_cycles_(window_cycles),
+      armed_(trigger.pc || trigger.data_addr || trigger.cycle),
+      tracing_(!armed_),
+      remaining_(window_cycles) {
+  history_.resize(history_cycles);
+}
+
+TraceWindow TraceWindow::FromFlags() {
+  Trigger trigger;
+  if (absl::GetFlag(FLAGS_trace_start_pc) >= 0)
+    trigger.pc = absl::GetFlag(FLAGS_trace_start_pc);
+  if (absl::GetFlag(FLAGS_trace_start_data_addr) >= 0)
+    trigger.data_addr = absl::GetFlag(FLAGS_trace_start_data_addr);
+  if (absl::GetFlag(FLAGS_trace_start_cycle) >= 0)
+    trigger.cycle = absl::GetFlag(FLAGS_trace_start_cycle);
+  return TraceWindow(trigger, absl::GetFlag(FLAGS_trace_window),
+                     absl::GetFlag(FLAGS_trace_history));
+}
+
+bool TraceWindow::Triggers(const Cycle& c) const {
+  if (trigger_.pc && c.pc == *trigger_.pc)
+    return true;
+  if (trigger_.data_addr && c.data_valid && c.data_addr == *trigger_.data_addr)
+    return true;
+  if (trigger_.cycle && c.cycle >= *trigger_.cycle)
+    return true;
+  return false;
+}
+
+void TraceWindow::Sample(const Cycle& c) {
+  if (!history_.empty()) {
+    history_[history_pos_] = c;
+    history_pos_ = (history_pos_ + 1) % history_.size();
+    if (history_pos_ == 0)
+      history_full_ = true;
+  }
+
+  if (armed_ && Triggers(c)) {
+    armed_ = false;
+    tracing_ = true;
+  } else if (tracing_ && window_cycles_ > 0 && --remaining_ <= 0) {
+    tracing_ = false;
+  }
+}
+
+void TraceWindow::DumpHistory(std::ostream& out) const {
+  const size_t count = history_full_ ? history_.size() : history_pos_;
+  const size_t start = history_full_ ? history_pos_ : 0;
+  out << "   cycle       pc | instr     addr     data | data wstrb     addr"
+         "    write     read\n";
+  for (size_t i = 0; i < count; i++) {
+    const Cycle& c = history_[(start + i) % history_.size()];
+    char line[128];
+    snprintf(line, sizeof(line),
+             "%8d %08x |     %c %08x %08x |    %c     %x %08x %08x %08x\n",
+             c.cycle, c.pc, c.instr_valid ? 'V' : '-', c.instr_addr,
+             c.instr_data, c.data_valid ? 'V' : '-', c.data_wstrb, c.data_addr,
+             c.data_write, c.data_read);
+    out << line;
+  }
+  out << std::flush;
+}
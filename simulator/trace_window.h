@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+// Decides which bus cycles of a simulation are worth writing to a trace file,
+// and keeps a short in-memory history of the most recent cycles so that it can
+// be dumped when something goes wrong, without tracing everything to disk.
+class TraceWindow {
+ public:
+  // Conditions that start tracing. Whichever is hit first wins. If none are
+  // set, tracing starts immediately.
+  struct Trigger {
+    std::optional<uint32_t> pc;         // The sequencer PC reaches this address.
+    std::optional<uint32_t> data_addr;  // The data bus accesses this address.
+    std::optional<int> cycle;           // This many bus cycles have elapsed.
+  };
+
+  // What the bus looked like on one clock.
+  struct Cycle {
+    int cycle;
+    uint32_t pc;
+    bool instr_valid;
+    uint32_t instr_addr;
+    uint32_t instr_data;
+    bool data_valid;
+    uint8_t data_wstrb;
+    uint32_t data_addr;
+    uint32_t data_write;
+    uint32_t data_read;
+  };
+
+  // Once triggered, traces for window_cycles bus cycles (0 means until the
+  // end of the run), and always remembers the last history_cycles cycles.
+  TraceWindow(const Trigger& trigger, int window_cycles, size_t history_cycles);
+
+  TraceWindow(TraceWindow&) = delete;
+
+  // Build a window from the --trace_start_*, --trace_window and
+  // --trace_history flags.
+  static TraceWindow FromFlags();
+
+  // Record a bus cycle. Call once per bus clock edge.
+  void Sample(const Cycle& c);
+
+  // Whether simulation steps should currently be dumped to the trace file.
+  bool tracing() const { return tracing_; }
+
+  // Write the remembered cycles, oldest first.
+  void DumpHistory(std::ostream& out) const;
+
+ private:
+  bool Triggers(const Cycle& c) const;
+
+  const Trigger trigger_;
+  const int window_cycles_;
+
+  bool armed_;
+  bool tracing_;
+  int remaining_ = 0;
+
+  std::vector<Cycle> history_;
+  size_t history_pos_ = 0;
+  bool history_full_ = false;
+};
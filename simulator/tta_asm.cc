@@ -0,0 +1,54 @@
+#include <absl/flags/flag.h>
+#include <absl/flags/parse.h>
+#include <glog/logging.h>
+
+#include <iostream>
+
+#include "text_assembler.h"
+
+ABSL_FLAG(std::string,
+          output,
+          "bootmem.mem",
+          "Write the program here, as $readmemh text, or host order words "
+          "for a .bin file");
+ABSL_FLAG(std::string,
+          data_output,
+          "",
+          "Write the .data section here, in the same forms as --output");
+ABSL_FLAG(bool,
+          optimize,
+          false,
+          "Schedule the moves in each basic block across the ALUs, and drop "
+          "register moves which aren't needed, see optimizer.h");
+ABSL_FLAG(bool,
+          report,
+          true,
+          "Print the size and estimated clocks of each basic block");
+
+// Assembles a program written the way the disassembly prints it, see
+// text_assembler.h:
+//   tta_asm [--output=bootmem.mem] [--data_output=data.bin] prog.s
+int main(int argc, char** argv) {
+  FLAGS_logtostderr = true;
+  google::InitGoogleLogging(argv[0]);
+  const std::vector<char*> args = absl::ParseCommandLine(argc, argv);
+  if (args.size() != 2) {
+    LOG(ERROR) << "Usage: " << args[0] << " [flags] source";
+    return 1;
+  }
+
+  TextAssembler assembler;
+  if (absl::GetFlag(FLAGS_optimize))
+    assembler.set_optimizer({});
+  if (!assembler.AssembleFile(args[1]))
+    return 1;
+  if (!assembler.WriteFile(absl::GetFlag(FLAGS_output)))
+    return 1;
+  if (!absl::GetFlag(FLAGS_data_output).empty() &&
+      !assembler.WriteFile(absl::GetFlag(FLAGS_data_output),
+                           TextAssembler::Section::kData))
+    return 1;
+  if (absl::GetFlag(FLAGS_report))
+    assembler.WriteReport(std::cout);
+  return 0;
+}
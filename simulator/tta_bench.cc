@@ -0,0 +1,242 @@
+#include <benchmark/benchmark.h>
+
+#include "assembler.h"
+#include "testbench.h"
+
+// Simulation throughput of the Verilated testtop on a few representative
+// programs. Reports host-side speed as simulated clocks per second, and
+// guest-side efficiency as clocks per retired instruction.
+//
+// Most programs are straight-line code sized to fit in program memory, and
+// run to the end once per iteration. The loop benchmarks compare the same
+// kernel looped in software and by the sequencer, per pass round the loop.
+
+namespace {
+
+// Upper bound on clocks any single instruction takes, for the run limit.
+constexpr int kMaxClocksPerInstr = 30;
+
+// Copy a block of data memory, one word per instruction.
+Program MemCopyProgram(int words) {
+  Program program;
+  for (int i = 0; i < words; i++) {
+    program.push_back(Instr()
+                          .Src(Unit::UNIT_MEMORY_IMMEDIATE)
+                          .Si(i)
+                          .Dst(Unit::UNIT_MEMORY_IMMEDIATE)
+                          .Di(words + i));
+  }
+  return program;
+}
+
+// Configure every ALU, then feed each one's result into the next one's left
+// operand, round and round.
+Program AluChainProgram(int rounds) {
+  static const ALUOp kOps[] = {ALUOp::ALU_ADD, ALUOp::ALU_SUB, ALUOp::ALU_MUL,
+                               ALUOp::ALU_SL,  ALUOp::ALU_SR,  ALUOp::ALU_ADD,
+                               ALUOp::ALU_MOD, ALUOp::ALU_XOR};
+  constexpr int kNumALUs = std::size(kOps);
+  Program program;
+  for (int alu = 0; alu < kNumALUs; alu++) {
+    program.push_back(Instr()
+                          .Src(Unit::UNIT_ABS_IMMEDIATE)
+                          .Si((int)kOps[alu])
+                          .Dst(Unit::UNIT_ALU_OPERATOR)
+                          .Di(alu));
+    program.push_back(Instr()
+                          .Src(Unit::UNIT_ABS_IMMEDIATE)
+                          .Si(alu + 3)
+                          .Dst(Unit::UNIT_ALU_RIGHT)
+                          .Di(alu));
+  }
+  for (int i = 0; i < rounds * kNumALUs; i++) {
+    program.push_back(Instr()
+                          .Src(Unit::UNIT_ALU_RESULT)
+                          .Si(i % kNumALUs)
+                          .Dst(Unit::UNIT_ALU_LEFT)
+                          .Di((i + 1) % kNumALUs));
+  }
+  return program;
+}
+
+// Follow a linked list through data memory, one hop per instruction.
+Program PointerChaseProgram(int hops) {
+  Program program;
+  program.push_back(
+      Instr().Src(Unit::UNIT_ABS_IMMEDIATE).Si(0).Dst(Unit::UNIT_REGISTER).Di(1));
+  for (int i = 0; i < hops; i++) {
+    program.push_back(Instr()
+                          .Src(Unit::UNIT_REGISTER_POINTER)
+                          .Si(1)
+                          .Dst(Unit::UNIT_REGISTER)
+                          .Di(1));
+  }
+  return program;
+}
+
+// Scatter a list through the first 512 words of data memory, so the chase
+// doesn't simply walk forwards.
+void LinkList(RAMSim* ram) {
+  constexpr IData kNodes = 512;
+  constexpr IData kStride = 97;  // coprime with kNodes
+  for (IData i = 0; i < kNodes; i++)
+    ram->mem()[(i * kStride) % kNodes] = ((i + 1) * kStride) % kNodes;
+}
+
+// Words of program memory a program takes.
+int Words(const Program& program) {
+  int words = 0;
+  for (const auto& instr : program)
+    words += instr.size();
+  return words;
+}
+
+// Copy words from the start of data memory to kCopyDst onwards, with one
+// instruction which copies a word and moves both pointers on.
+constexpr int kCopyDst = 512;
+
+Program CopySetup() {
+  return {
+      Instr().Src(Unit::UNIT_ABS_IMMEDIATE).Si(0).Dst(Unit::UNIT_REGISTER).Di(1),
+      Instr()
+          .Src(Unit::UNIT_ABS_IMMEDIATE)
+          .Si(kCopyDst)
+          .Dst(Unit::UNIT_REGISTER)
+          .Di(2),
+  };
+}
+
+Instr CopyWord() {
+  return Instr()
+      .Src(Unit::UNIT_REGISTER_POINTER)
+      .Si(1)
+      .SrcPtr(PtrMode::PTR_POST_INC)
+      .Dst(Unit::UNIT_REGISTER_POINTER)
+      .Di(2)
+      .DstPtr(PtrMode::PTR_POST_INC);
+}
+
+// Counting down in ALU 0 and branching back while there's more to do: two
+// instructions of bookkeeping per pass.
+Program SoftwareLoopProgram(int passes) {
+  Program program = CopySetup();
+  program.push_back(Instr()
+                        .Src(Unit::UNIT_ABS_IMMEDIATE)
+                        .Si(passes + 1)
+                        .Dst(Unit::UNIT_ALU_LEFT)
+                        .Di(0));
+  program.push_back(
+      Instr().Src(Unit::UNIT_ABS_IMMEDIATE).Si(1).Dst(Unit::UNIT_ALU_RIGHT).Di(0));
+  program.push_back(Instr()
+                        .Src(Unit::UNIT_ABS_IMMEDIATE)
+                        .Si((int)ALUOp::ALU_SUB)
+                        .Dst(Unit::UNIT_ALU_OPERATOR)
+                        .Di(0));
+  const int loop = Words(program);
+  program.push_back(CopyWord());
+  program.push_back(Instr()
+                        .Src(Unit::UNIT_ALU_RESULT)
+                        .Si(0)
+                        .Dst(Unit::UNIT_ALU_LEFT)
+                        .Di(0));
+  program.push_back(Instr()
+                        .Src(Unit::UNIT_ABS_IMMEDIATE)
+                        .Si(loop)
+                        .Dst(Unit::UNIT_PC)
+                        .If(Unit::UNIT_ALU_RESULT, 0));
+  return program;
+}
+
+// The same through the hardware loop, with no bookkeeping in the loop.
+Program HardwareLoopProgram(int passes) {
+  Program program = CopySetup();
+  const int loop = Words(program) + 3;
+  auto ctrl = [](ControlReg reg, int value) {
+    return Instr()
+        .Src(Unit::UNIT_ABS_IMMEDIATE)
+        .Si(value)
+        .Dst(Unit::UNIT_CONTROL)
+        .Di((int)reg);
+  };
+  program.push_back(ctrl(ControlReg::CTRL_LOOP_START, loop));
+  program.push_back(ctrl(ControlReg::CTRL_LOOP_END, loop + 1));
+  program.push_back(ctrl(ControlReg::CTRL_LOOP_COUNT, passes));
+  program.push_back(CopyWord());
+  return program;
+}
+
+// Runs the program until instructions have retired, by default one for
+// each in the program. Returns the clocks each run took.
+double RunProgram(benchmark::State& state,
+                  const Program& program,
+                  void (*setup)(RAMSim*) = nullptr,
+                  int instructions = 0) {
+  if (!instructions)
+    instructions = program.size();
+  int64_t clocks = 0;
+  int64_t retired = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    // A fresh model each time; the clock generator only resets once.
+    TestBench bench;
+    bench.Reset();
+    bench.Load(program);
+    bench.RunUntil(&bench.top()->rst_i, (CData)1, 1);  // Clear the reset
+    if (setup)
+      setup(bench.ram());
+    const IData start_clocks = bench.top()->cycles_executed_o;
+    state.ResumeTiming();
+
+    retired += bench.RunInstructions(instructions,
+                                     instructions * kMaxClocksPerInstr);
+
+    state.PauseTiming();
+    clocks += (IData)(bench.top()->cycles_executed_o - start_clocks);
+    state.ResumeTiming();
+  }
+  if (retired < (int64_t)instructions * state.iterations())
+    state.SkipWithError("Program did not run to completion");
+  state.counters["cycles/s"] =
+      benchmark::Counter(clocks, benchmark::Counter::kIsRate);
+  state.counters["clocks/instr"] = retired ? (double)clocks / retired : 0;
+  state.SetItemsProcessed(retired);
+  return state.iterations() ? (double)clocks / state.iterations() : 0;
+}
+
+void BM_MemCopy(benchmark::State& state) {
+  RunProgram(state, MemCopyProgram(state.range(0)));
+}
+BENCHMARK(BM_MemCopy)->Arg(256)->Arg(512);
+
+void BM_AluChain(benchmark::State& state) {
+  RunProgram(state, AluChainProgram(state.range(0)));
+}
+BENCHMARK(BM_AluChain)->Arg(16)->Arg(64);
+
+void BM_PointerChase(benchmark::State& state) {
+  RunProgram(state, PointerChaseProgram(state.range(0)), LinkList);
+}
+BENCHMARK(BM_PointerChase)->Arg(256)->Arg(512);
+
+// Clocks per pass round a one-instruction loop body, bookkeeping included.
+void BM_SoftwareLoop(benchmark::State& state) {
+  const int passes = state.range(0);
+  const Program program = SoftwareLoopProgram(passes);
+  const double clocks = RunProgram(state, program, nullptr,
+                                   program.size() - 3 + 3 * passes);
+  state.counters["clocks/iter"] = clocks / passes;
+}
+BENCHMARK(BM_SoftwareLoop)->Arg(64)->Arg(256);
+
+void BM_HardwareLoop(benchmark::State& state) {
+  const int passes = state.range(0);
+  const Program program = HardwareLoopProgram(passes);
+  const double clocks =
+      RunProgram(state, program, nullptr, program.size() - 1 + passes);
+  state.counters["clocks/iter"] = clocks / passes;
+}
+BENCHMARK(BM_HardwareLoop)->Arg(64)->Arg(256);
+
+}  // namespace
+
+BENCHMARK_MAIN();
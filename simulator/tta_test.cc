@@ -1,13 +1,33 @@
+#include <absl/flags/flag.h>
+#include <absl/flags/parse.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
-#include <verilated_fst_c.h>
 
-#include <memory>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <random>
 
-#include "Vtesttop.h"
 #include "assembler.h"
-#include "clock_gen.h"
-#include "ram_sim.h"
+#include "batch.h"
+#include "emulator.h"
+#include "test_programs.h"
+#include "testbench.h"
+
+ABSL_FLAG(bool, trace_tests, false, "Write an FST trace file for every test");
+
+// Set when built against the pipelined testtop, which also has the
+// prefetch buffer and the ALU scoreboard.
+#ifndef TTA_PIPELINED
+#define TTA_PIPELINED 0
+#endif
+constexpr bool kPipelined = TTA_PIPELINED;
+// Words the prefetch buffer of the testtop built against reads ahead, if it
+// has one.
+#ifndef TTA_PREFETCH_DEPTH
+#define TTA_PREFETCH_DEPTH 0
+#endif
+constexpr int kPrefetchDepth = TTA_PREFETCH_DEPTH;
 
 // A kind of integration tests that runs through some common
 // operations and checks their results.
@@ -16,30 +36,12 @@
 // TODO: unit tests which run against the individual components
 // (Execute/Decode/Sequencer etc) rather than the top level.
 
-class TTATest : public ::testing::Test {
- public:
-  TTATest()
-      : top_(std::make_unique<Vtesttop>()),
-        clock_gen_(1, 1 /* reset_cycles */, &top_->rst_i, &top_->sysclk_i),
-        prg_(1024,
-             c_gnd_,
-             top_->instr_valid_o,
-             &top_->instr_ready_i,
-             &top_->instr_data_read_i,
-             i_gnd_,
-             top_->instr_addr_o),
-        ram_(1024,
-             top_->data_wstrb_o,
-             top_->data_valid_o,
-             &top_->data_ready_i,
-             &top_->data_data_read_i,
-             top_->data_data_write_o,
-             top_->data_addr_o) {}
-
+class TTATest : public ::testing::Test, public TestBench {
  protected:
   void SetUp() override {
     Reset();
-    Verilated::traceEverOn(true);
+    if (!absl::GetFlag(FLAGS_trace_tests))
+      return;
     std::string trace_name = ::testing::UnitTest::GetInstance()
                                  ->current_test_info()
                                  ->test_case_name();
@@ -47,85 +49,38 @@ class TTATest : public ::testing::Test {
     trace_name.append(
         ::testing::UnitTest::GetInstance()->current_test_info()->name());
     trace_name.append(".vcd");
-    trace_ = std::make_unique<VerilatedFstC>();
-    top_->trace(trace_.get(), 99);
-    trace_->open(trace_name.c_str());
+    OpenTrace(trace_name);
   }
 
   void TearDown() override {
-    trace_->flush();
-    trace_->close();
-  }
-
- public:
-  void Reset() { top_->rst_i = 1; }
-
-  void Step() {
-    clock_gen_.Step(trace_.get());
-    top_->eval();
-    if (!top_->rst_i & clock_gen_.Bus()) {
-      ram_.Do();
-      prg_.Do();
+    if (divergence())
+      ADD_FAILURE() << *divergence();
+    if (HasFailure()) {
+      std::cerr << "Last bus cycles before failure:" << std::endl;
+      window().DumpHistory(std::cerr);
     }
+    CloseTrace();
   }
 
-  /*
-   * Run until "pin" equals "val" or max_clocks has been reached.
-   * Returns true if the pin reached the intended value before the clock ran
-   * out.
-   */
-  template <typename T>
-  bool RunUntil(T* pin, T val, int max_clocks) {
-    int start_clocks = clock_gen_.cycles();
-    while (!Verilated::gotFinish()) {
-      Step();
-
-      if (*pin == val || clock_gen_.cycles())
-        return true;
-      else if (clock_gen_.cycles() - start_clocks >= max_clocks)
-        return false;
-    }
-    return false;
+  // Load t, release the reset, run it through and check what it leaves.
+  void Run(const TestProgram& t) {
+    Load(t.program);
+    ASSERT_TRUE(RunUntil(&top()->rst_i, (CData)1, 1));  // Clear the reset
+    for (const auto& [addr, value] : t.memory)
+      ram()->mem()[addr] = value;
+    EXPECT_EQ(RunInstructions(t.retired, t.retired * 20 + t.wait_clocks),
+              t.retired);
+    RunUntil(10);
+    Check(t);
   }
 
-  /**
-   * Run until max_clocks cycles have executed.
-   */
-  int RunUntil(int max_clocks) {
-    int start_clk = clock_gen_.cycles();
-    while (!Verilated::gotFinish() &&
-           (clock_gen_.cycles() < max_clocks + start_clk)) {
-      Step();
-    }
-    return clock_gen_.cycles() - start_clk;
-  }
-
-  void Load(const Program& program, uint32_t addr = 0) {
-    off_t pos = addr;
-    for (auto& instr : program) {
-      std::vector<uint32_t> code = instr.assemble();
-      for (const auto& op : code) {
-        prg_.mem()[pos++] = op;
-      }
-    }
+  // Whether the registers and memory are what t should leave.
+  void Check(const TestProgram& t) {
+    for (const auto& [r, value] : t.regs)
+      EXPECT_EQ(top()->regs_o[r], value) << "R" << r;
+    for (const auto& [addr, value] : t.results)
+      EXPECT_EQ(ram()->mem()[addr], value) << "at " << addr;
   }
-
- protected:
-  std::unique_ptr<VerilatedFstC> trace_;
-
-  Vtesttop* top() const { return top_.get(); }
-  const ClockGenerator& clk() const { return clock_gen_; }
-  RAMSim* ram() { return &ram_; }
-  RAMSim* prg() { return &prg_; }
-
- private:
-  std::unique_ptr<Vtesttop> top_;
-  ClockGenerator clock_gen_;
-  RAMSim prg_;
-  RAMSim ram_;
-
-  CData c_gnd_ = 0;
-  IData i_gnd_ = 0;
 };
 
 TEST_F(TTATest, Initialize) {
@@ -154,6 +109,35 @@ TEST_F(TTATest, RegisterSetAbsMemorySetAbs) {
   EXPECT_EQ(ram()->mem()[123], 666);
 }
 
+// Programs can come from $readmemh text, as assembler.py writes it.
+TEST_F(TTATest, LoadHexImage) {
+  const std::string filename = ::testing::TempDir() + "/LoadHexImage.mem";
+  {
+    std::ofstream out(filename);
+    out << "// R00 := #29a, then *(07b) := R00\n";
+    for (const auto& word : Instr()
+                                .Src(Unit::UNIT_ABS_IMMEDIATE)
+                                .Si(666)
+                                .Dst(Unit::UNIT_REGISTER)
+                                .Di(0)
+                                .assemble())
+      out << std::hex << word << " ";
+    out << "\n@1 /* after a gap */ ";
+    for (const auto& word : Instr()
+                                .Src(Unit::UNIT_REGISTER)
+                                .Si(0)
+                                .Dst(Unit::UNIT_MEMORY_IMMEDIATE)
+                                .Di(123)
+                                .assemble())
+      out << std::hex << word << "\n";
+  }
+  ASSERT_TRUE(LoadFile(filename));
+  ASSERT_TRUE(RunUntil(&top()->rst_i, (CData)1, 1));  // Clear the reset
+
+  RunUntil(8);
+  EXPECT_EQ(ram()->mem()[123], 666);
+}
+
 TEST_F(TTATest, MemImmediateToMemImmediate) {
   Load({Instr()
             .Src(Unit::UNIT_MEMORY_IMMEDIATE)
@@ -237,4 +221,401 @@ TEST_F(TTATest, AluAddition) {
   EXPECT_EQ(ram()->mem()[123], 777);
 }
 
-// TODO: set/get PC, stack, other ALU ops
\ No newline at end of file
+// Moves into the PC jump, and the PC as a source is the address of the next
+// instruction.
+TEST_F(TTATest, PcWrite) {
+  Load({Instr().Src(Unit::UNIT_ABS_IMMEDIATE).Si(3).Dst(Unit::UNIT_PC),
+        Instr()
+            .Src(Unit::UNIT_ABS_IMMEDIATE)
+            .Si(111)
+            .Dst(Unit::UNIT_MEMORY_IMMEDIATE)
+            .Di(100),
+        Instr()
+            .Src(Unit::UNIT_ABS_IMMEDIATE)
+            .Si(111)
+            .Dst(Unit::UNIT_MEMORY_IMMEDIATE)
+            .Di(101),
+        Instr()
+            .Src(Unit::UNIT_ABS_IMMEDIATE)
+            .Si(222)
+            .Dst(Unit::UNIT_MEMORY_IMMEDIATE)
+            .Di(102),
+        Instr().Src(Unit::UNIT_PC).Dst(Unit::UNIT_MEMORY_IMMEDIATE).Di(103)});
+  ASSERT_TRUE(RunUntil(&top()->rst_i, (CData)1, 1));  // Clear the reset
+  EXPECT_EQ(RunInstructions(3, 3 * 20), 3);
+  RunUntil(10);
+  EXPECT_EQ(ram()->mem()[100], 0);
+  EXPECT_EQ(ram()->mem()[101], 0);
+  EXPECT_EQ(ram()->mem()[102], 222);
+  EXPECT_EQ(ram()->mem()[103], 5);
+}
+
+// Register and immediate moves into non-memory units are written in the same
+// cycle the source is read. Moves into memory take one more to put the store
+// on the bus, and another for it to be taken.
+TEST_F(TTATest, SingleCycleMoves) {
+  if (kPipelined)
+    GTEST_SKIP() << "Fetch rather than execute sets the pace when pipelined";
+
+  constexpr int kMoves = 16;
+  Program program;
+  for (int i = 0; i <= kMoves; i++) {
+    program.push_back(i % 2 ? Instr()
+                                  .Src(Unit::UNIT_REGISTER)
+                                  .Si(i % 8)
+                                  .Dst(Unit::UNIT_REGISTER)
+                                  .Di(i % 8 + 8)
+                            : Instr()
+                                  .Src(Unit::UNIT_ABS_IMMEDIATE)
+                                  .Si(i)
+                                  .Dst(Unit::UNIT_REGISTER)
+                                  .Di(i % 8));
+  }
+  for (int i = 0; i <= kMoves; i++) {
+    program.push_back(i % 2 ? Instr()
+                                  .Src(Unit::UNIT_REGISTER)
+                                  .Si(i % 8)
+                                  .Dst(Unit::UNIT_MEMORY_IMMEDIATE)
+                                  .Di(100 + i)
+                            : Instr()
+                                  .Src(Unit::UNIT_ABS_IMMEDIATE)
+                                  .Si(i)
+                                  .Dst(Unit::UNIT_MEMORY_IMMEDIATE)
+                                  .Di(100 + i));
+  }
+  Load(program);
+  ASSERT_TRUE(RunUntil(&top()->rst_i, (CData)1, 1));  // Clear the reset
+
+  // Time kMoves instructions of each kind, from the retirement of the one
+  // before them to the retirement of the last, so both include the same
+  // fetches.
+  auto time_moves = [&]() {
+    EXPECT_EQ(RunInstructions(1, 20), 1);
+    const int start = clk().cycles();
+    EXPECT_EQ(RunInstructions(kMoves, kMoves * 20), kMoves);
+    return clk().cycles() - start;
+  };
+  const int register_clocks = time_moves();
+  const int memory_clocks = time_moves();
+  EXPECT_EQ(memory_clocks - register_clocks, 2 * kMoves);
+}
+
+// The prefetch buffer fetches words before the sequencer asks for them, but
+// runs the same program to the same results.
+TEST_F(TTATest, PrefetchReadsAhead) {
+  constexpr int kMoves = 32;
+  Program program;
+  for (int i = 0; i < kMoves; i++) {
+    program.push_back(Instr()
+                          .Src(Unit::UNIT_ABS_IMMEDIATE)
+                          .Si(i)
+                          .Dst(Unit::UNIT_REGISTER)
+                          .Di(i % 8));
+  }
+  Load(program);
+  EnableLockstep();
+  ASSERT_TRUE(RunUntil(&top()->rst_i, (CData)1, 1));  // Clear the reset
+
+  // The furthest fetch by the time the eighth instruction, at address 7,
+  // retires. The sequencer alone gets no further than the one after it.
+  constexpr int kRetired = 8;
+  IData furthest = 0;
+  while (retired() < kRetired && clk().cycles() < kRetired * 20) {
+    Step();
+    if (top()->instr_valid_o)
+      furthest = std::max(furthest, top()->instr_addr_o);
+  }
+  ASSERT_EQ(retired(), kRetired);
+  if (kPrefetchDepth > 0)
+    EXPECT_GT(furthest, kRetired);
+  else
+    EXPECT_LE(furthest, kRetired);
+
+  EXPECT_EQ(RunInstructions(kMoves - kRetired, kMoves * 20),
+            kMoves - kRetired);
+  for (int r = 0; r < 8; r++)
+    EXPECT_EQ(top()->regs_o[r], kMoves - 8 + r);
+}
+
+// Guest code can read, and clear, the performance counters.
+TEST_F(TTATest, PerfCounters) {
+  Run(PerfCountersProgram());
+  EXPECT_GT(ram()->mem()[203], 0);
+}
+
+// Pushes and pops move the top of the stack; peeks and pokes reach below it
+// without moving it.
+TEST_F(TTATest, Stack) {
+  EnableLockstep();
+  Run(StackProgram());
+}
+
+// Byte and halfword accesses take byte addresses, and extend as asked.
+TEST_F(TTATest, SubWordAccess) {
+  EnableLockstep();
+  Run(SubWordAccessProgram());
+}
+
+// Stores through a register pointer, and pointers which step themselves.
+TEST_F(TTATest, PointerUpdate) {
+  EnableLockstep();
+  Run(PointerUpdateProgram());
+}
+
+// Multiply and divide take several cycles. Reading the result waits for it;
+// CTRL_ALU_BUSY shows which ALUs are still working.
+TEST_F(TTATest, MultiCycleAlu) {
+  EnableLockstep();
+  Run(MultiCycleAluProgram());
+}
+
+// With the scoreboard, moves which don't depend on a read of a busy ALU go
+// ahead of it; the rest wait for it.
+TEST_F(TTATest, Scoreboard) {
+  EnableLockstep();
+  const TestProgram t = ScoreboardProgram();
+  Load(t.program);
+  ASSERT_TRUE(RunUntil(&top()->rst_i, (CData)1, 1));  // Clear the reset
+  for (int i = 0; i < 200 && top()->regs_o[2] != 5; i++)
+    RunUntil(1);
+  ASSERT_EQ(top()->regs_o[2], 5);
+  EXPECT_EQ(top()->regs_o[1], kPipelined ? 0 : 142);  // still dividing?
+  const int remaining = t.retired - retired();
+  EXPECT_EQ(RunInstructions(remaining, 200), remaining);
+  RunUntil(10);
+  Check(t);
+}
+
+// Bundled moves happen alongside the instruction they're paired with.
+TEST_F(TTATest, Bundle) {
+  EnableLockstep();
+  Run(BundleProgram());
+}
+
+// Guarded instructions are squashed when their guard is zero, or with
+// IfNot(), non-zero.
+TEST_F(TTATest, Guard) {
+  EnableLockstep();
+  Run(GuardProgram());
+}
+
+// The sequencer goes round a hardware loop without any instructions to do
+// so; the count is already down by the time the last one of each pass runs.
+TEST_F(TTATest, HardwareLoop) {
+  EnableLockstep();
+  Run(LoopProgram());
+}
+
+// A byte arriving at the UART interrupts the idle loop, and the handler
+// echoes it back. The emulator has no UART, so this runs without lockstep.
+TEST_F(TTATest, UartInterrupt) {
+  auto move = [](Unit src, int si, Unit dst, int di) {
+    return Instr().Src(src).Si(si).Dst(dst).Di(di);
+  };
+  const Unit kImm = Unit::UNIT_ABS_IMMEDIATE;
+  const Unit kCtrl = Unit::UNIT_CONTROL;
+  const uint32_t kData = (uint32_t)UartReg::UART_DATA;
+  Load({
+      move(kImm, 3, kCtrl, (int)ControlReg::CTRL_IRQ_VECTOR),
+      move(kImm, 1 << (int)IrqSource::IRQ_UART_RX, kCtrl,
+           (int)ControlReg::CTRL_IRQ_ENABLE),
+      move(kImm, 2, Unit::UNIT_PC, 0),  // 2
+      move(Unit::UNIT_MEMORY_OPERAND, 0, Unit::UNIT_REGISTER, 1)
+          .Soperand(kData),  // 3
+      move(Unit::UNIT_REGISTER, 1, Unit::UNIT_MEMORY_OPERAND, 0)
+          .Doperand(kData),
+      move(Unit::UNIT_REGISTER, 1, Unit::UNIT_MEMORY_IMMEDIATE, 100),
+      move(kImm, 0, kCtrl, (int)ControlReg::CTRL_IRQ_RETURN),
+  });
+  ASSERT_TRUE(RunUntil(&top()->rst_i, (CData)1, 1));  // Clear the reset
+  uart()->Send("A");
+
+  // Over there and back, with time to spare.
+  RunUntil(kUartClocksPerBit * 10 * 3);
+  EXPECT_FALSE(uart()->sending());
+  EXPECT_EQ(top()->regs_o[1], 'A');
+  EXPECT_EQ(ram()->mem()[100], 'A');
+  EXPECT_EQ(uart_output(), "A");
+}
+
+// More than the console holds, so it has to be drained part way.
+constexpr int kConsoleBytes = 2 * TestBench::kConsoleDepth + 6;
+
+// A store to a full console isn't taken until it's drained, and the
+// instruction making it doesn't retire until then.
+TEST_F(TTATest, ConsoleStall) {
+  Load(ConsoleProgram(kConsoleBytes).program);
+  EnableLockstep();
+  HoldConsole(true);
+  ASSERT_TRUE(RunUntil(&top()->rst_i, (CData)1, 1));  // Clear the reset
+  RunUntil(1000);
+  EXPECT_EQ(console_output(), "");
+  EXPECT_EQ(top()->console_count_o, kConsoleDepth);
+  EXPECT_EQ(retired(), kConsoleDepth);
+  RunUntil(1000);
+  EXPECT_EQ(retired(), kConsoleDepth);
+
+  HoldConsole(false);
+  RunUntil(1000);
+  EXPECT_EQ(console_output(), ConsoleBytes(kConsoleBytes));
+  EXPECT_GT(retired(), kConsoleBytes + 1);
+  // Lockstep stops at the read, which the emulator can't know the answer
+  // to.
+  EXPECT_LE(top()->regs_o[1], (IData)kConsoleDepth);
+}
+
+// Every byte comes out once, in order, whichever clock the console is
+// drained on, including those a byte is written on.
+TEST_F(TTATest, ConsoleDrainClock) {
+  int kept = 0;
+  for (int interval = 1; interval <= 16; interval++) {
+    TestBench bench;
+    bench.SetConsoleDrain(interval);
+    bench.Load(ConsoleProgram(kConsoleBytes).program);
+    bench.EnableLockstep();
+    bench.Reset();
+    while (bench.retired() <= kConsoleBytes + 1 &&
+           bench.clk().cycles() < 4000) {
+      const bool draining = bench.top()->console_drain_i;
+      bench.Step();
+      // The clock after a drain, which leaves only what was written along
+      // with it.
+      if (draining && !bench.top()->console_drain_i &&
+          bench.top()->console_count_o != 0)
+        kept++;
+    }
+    bench.RunUntil(100);
+    EXPECT_EQ(bench.console_output(), ConsoleBytes(kConsoleBytes))
+        << "Draining every " << interval;
+    EXPECT_FALSE(bench.divergence()) << *bench.divergence();
+  }
+  EXPECT_GT(kept, 0);
+}
+
+namespace {
+
+// A random straight-line program using only moves execute.sv supports, and
+// touching only the first 256 words of data memory. Register pointers only
+// go through registers holding one of those addresses: ones not yet
+// written, which are zero, or last loaded from an operand.
+Program RandomProgram(unsigned seed, int length) {
+  static const Unit kSrcUnits[] = {
+      Unit::UNIT_ABS_IMMEDIATE,    Unit::UNIT_ABS_OPERAND,
+      Unit::UNIT_REGISTER,         Unit::UNIT_MEMORY_IMMEDIATE,
+      Unit::UNIT_MEMORY_OPERAND,   Unit::UNIT_ALU_LEFT,
+      Unit::UNIT_ALU_RIGHT,        Unit::UNIT_ALU_RESULT,
+      Unit::UNIT_REGISTER_POINTER,
+  };
+  static const Unit kDstUnits[] = {
+      Unit::UNIT_REGISTER,       Unit::UNIT_MEMORY_IMMEDIATE,
+      Unit::UNIT_MEMORY_OPERAND, Unit::UNIT_ALU_LEFT,
+      Unit::UNIT_ALU_RIGHT,      Unit::UNIT_ALU_OPERATOR,
+  };
+  std::mt19937 rng(seed);
+  auto pick = [&rng](int n) { return (int)(rng() % n); };
+
+  std::vector<int> pointers(Emulator::kNumRegisters);
+  for (int r = 0; r < Emulator::kNumRegisters; r++)
+    pointers[r] = r;
+
+  Program program;
+  for (int i = 0; i < length; i++) {
+    Instr instr;
+    Unit src = kSrcUnits[pick(std::size(kSrcUnits))];
+    Unit dst = kDstUnits[pick(std::size(kDstUnits))];
+    if (src == Unit::UNIT_REGISTER_POINTER && pointers.empty())
+      src = Unit::UNIT_REGISTER;
+    instr.Src(src).Dst(dst);
+    switch (src) {
+      case Unit::UNIT_REGISTER:
+        instr.Si(pick(Emulator::kNumRegisters));
+        break;
+      case Unit::UNIT_REGISTER_POINTER:
+        instr.Si(pointers[pick(pointers.size())]);
+        break;
+      case Unit::UNIT_ALU_LEFT:
+      case Unit::UNIT_ALU_RIGHT:
+      case Unit::UNIT_ALU_RESULT:
+        instr.Si(pick(Emulator::kNumALUs));
+        break;
+      case Unit::UNIT_MEMORY_IMMEDIATE:
+        instr.Si(pick(256));
+        break;
+      case Unit::UNIT_MEMORY_OPERAND:
+        instr.Si(0).Soperand(pick(256));
+        break;
+      case Unit::UNIT_ABS_OPERAND:
+        // Small enough to be usable as a pointer.
+        instr.Si(0).Soperand(pick(256));
+        break;
+      default:
+        instr.Si(pick(1 << 12));
+        break;
+    }
+    switch (dst) {
+      case Unit::UNIT_REGISTER: {
+        const int r = pick(Emulator::kNumRegisters);
+        instr.Di(r);
+        auto it = std::find(pointers.begin(), pointers.end(), r);
+        if (src == Unit::UNIT_ABS_OPERAND) {
+          if (it == pointers.end())
+            pointers.push_back(r);
+        } else if (it != pointers.end()) {
+          pointers.erase(it);
+        }
+        break;
+      }
+      case Unit::UNIT_ALU_LEFT:
+      case Unit::UNIT_ALU_RIGHT:
+      case Unit::UNIT_ALU_OPERATOR:
+        instr.Di(pick(Emulator::kNumALUs));
+        break;
+      case Unit::UNIT_MEMORY_IMMEDIATE:
+        instr.Di(pick(256));
+        break;
+      default:
+        instr.Di(0).Doperand(pick(256));
+        break;
+    }
+    program.push_back(instr);
+  }
+  return program;
+}
+
+}  // namespace
+
+// Random programs should leave the RTL in the same state as the emulator
+// after every instruction.
+TEST_F(TTATest, LockstepRandomProgram) {
+  EnableLockstep();
+  Load(RandomProgram(1234, 200));
+  ASSERT_TRUE(RunUntil(&top()->rst_i, (CData)1, 1));  // Clear the reset
+  EXPECT_EQ(RunInstructions(200, 200 * 20), 200);
+}
+
+// The same over a batch, spread across threads, each program in a model of
+// its own.
+TEST_F(TTATest, BatchRandomPrograms) {
+  constexpr int kPrograms = 32;
+  constexpr int kLength = 50;
+  std::vector<Program> programs;
+  for (int i = 0; i < kPrograms; i++)
+    programs.push_back(RandomProgram(i, kLength));
+  BatchOptions options;
+  options.max_clocks = kLength * 20;
+  options.threads = 4;
+  const std::vector<BatchResult> results = RunBatch(programs, options);
+  ASSERT_EQ(results.size(), (size_t)kPrograms);
+  for (int i = 0; i < kPrograms; i++) {
+    EXPECT_EQ(results[i].retired, kLength) << "program " << i;
+    EXPECT_FALSE(results[i].divergence) << *results[i].divergence;
+  }
+}
+
+// TODO: other ALU ops
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  absl::ParseCommandLine(argc, argv);
+  return RUN_ALL_TESTS();
+}
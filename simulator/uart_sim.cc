@@ -23,3 +23,46 @@ void UARTSim::Push(bool b) {
       }
   }
 }
+
+void UARTSim::Clock(bool txd, CData* rxd) {
+  // The usual case: an idle line both ways, where only a start bit on txd
+  // can change anything.
+  if (rx_wait_ < 0 && txd && tx_wait_ == 0 && !sending()) {
+    *rxd = 1;
+    return;
+  }
+
+  if (rx_wait_ < 0) {
+    if (!txd)
+      rx_wait_ = clocks_per_bit_ / 2;
+  } else if (rx_wait_ == 0) {
+    Push(txd);
+    // A start bit which didn't last leaves it waiting for another.
+    rx_wait_ = state == NEED_START ? -1 : clocks_per_bit_ - 1;
+  } else {
+    rx_wait_--;
+  }
+
+  if (tx_wait_ > 0) {
+    tx_wait_--;
+    return;
+  }
+  if (tx_bits_ == 0) {
+    if (tx_queue_.empty()) {
+      *rxd = 1;
+      return;
+    }
+    // Stop bit, data, start bit.
+    tx_frame_ = 0x200 | (static_cast<unsigned char>(tx_queue_.front()) << 1);
+    tx_queue_.pop_front();
+    tx_bits_ = 10;
+  }
+  *rxd = tx_frame_ & 1;
+  tx_frame_ >>= 1;
+  tx_bits_--;
+  tx_wait_ = clocks_per_bit_ - 1;
+}
+
+void UARTSim::Send(const std::string& bytes) {
+  tx_queue_.insert(tx_queue_.end(), bytes.begin(), bytes.end());
+}
@@ -1,17 +1,84 @@
 #pragma once
 
+#include <verilated.h>
+
+#include <cstdint>
+#include <deque>
 #include <ostream>
+#include <string>
 
+// The far end of an 8N1 serial line. What the design sends comes out on
+// out_stream; what's given to Send() goes back to it.
 class UARTSim {
  public:
-  explicit UARTSim(std::ostream& out_stream) : out_(out_stream) {}
+  // Bus clocks a bit, as simtop's UART is built with.
+  static constexpr int kClocksPerBit = 651;
+
+  explicit UARTSim(std::ostream& out_stream,
+                   int clocks_per_bit = kClocksPerBit)
+      : out_(out_stream), clocks_per_bit_(clocks_per_bit) {}
 
+  // Takes the next bit received, already sampled once per bit time.
   void Push(bool b);
 
+  // Advances a bus clock: samples txd in the middle of each bit, from the
+  // start bit's falling edge, and drives rxd with whatever has been queued
+  // by Send(), or idle high.
+  void Clock(bool txd, CData* rxd);
+
+  // Queues bytes to be sent to the design.
+  void Send(const std::string& bytes);
+
+  // Whether anything queued by Send() is still to be sent.
+  bool sending() const { return tx_bits_ != 0 || !tx_queue_.empty(); }
+
+  // Checkpoint the line state and anything still to send, as
+  // MemoryImage::Save() and Restore(). Output already written stays written.
+  template <typename Out>
+  void Save(Out& out) const {
+    out.write(&state, sizeof(state));
+    out.write(&x_, sizeof(x_));
+    out.write(&bit_, sizeof(bit_));
+    out.write(&rx_wait_, sizeof(rx_wait_));
+    const uint64_t queued = tx_queue_.size();
+    out.write(&queued, sizeof(queued));
+    for (char c : tx_queue_)
+      out.write(&c, 1);
+    out.write(&tx_frame_, sizeof(tx_frame_));
+    out.write(&tx_bits_, sizeof(tx_bits_));
+    out.write(&tx_wait_, sizeof(tx_wait_));
+  }
+  template <typename In>
+  void Restore(In& in) {
+    in.read(&state, sizeof(state));
+    in.read(&x_, sizeof(x_));
+    in.read(&bit_, sizeof(bit_));
+    in.read(&rx_wait_, sizeof(rx_wait_));
+    uint64_t queued;
+    in.read(&queued, sizeof(queued));
+    tx_queue_.resize(queued);
+    for (char& c : tx_queue_)
+      in.read(&c, 1);
+    in.read(&tx_frame_, sizeof(tx_frame_));
+    in.read(&tx_bits_, sizeof(tx_bits_));
+    in.read(&tx_wait_, sizeof(tx_wait_));
+  }
+
  private:
   enum State { NEED_START, RECV, NEED_STOP };
   State state = NEED_START;
   char x_ = 0;
   unsigned int bit_ = 0;
   std::ostream& out_;
+
+  const int clocks_per_bit_;
+  // Clocks to the next sample of txd, or -1 waiting for a start bit.
+  int rx_wait_ = -1;
+
+  std::deque<char> tx_queue_;
+  // The rest of the frame being sent, from the bottom.
+  unsigned int tx_frame_ = 0;
+  int tx_bits_ = 0;
+  // Clocks the bit on rxd has still to be held for.
+  int tx_wait_ = 0;
 };